@@ -4,6 +4,7 @@
 #include "classes/Chess.h"
 #include "classes/Zobrist.h"
 #include "classes/MoveGenerator.h"
+#include "classes/Perft.h"
 
 namespace ClassGame {
         //
@@ -14,55 +15,6 @@ namespace ClassGame {
         int gameWinner = -1;
         Zobrist zobrist;
 
-        uint64_t perft(MoveGenerator* mg, int depth){
-            int i;
-            uint64_t nodes = 0;
-
-            if(depth == 0)
-                return 1ULL;
-
-            mg->generateMoves();
-            if(depth == 1)
-                return mg->moveCount;
-
-            uint32_t moveList[256];
-            mg->copyMoveList(moveList);
-            int moveCount = mg->copyMoveCount();
-
-
-            for(i = 0; i < moveCount; i++){
-                // Copy board state
-                uint64_t bitboards[12];
-                mg->copyBitboards(bitboards);
-                uint64_t allBlacks = mg->copyAllBlacks();
-                uint64_t allWhites = mg->copyAllWhites();
-                int side = mg->copySide();
-                int castle = mg->copyCastle();
-                int enpassant = mg->copyEnpassant();
-                int enpassantPiece = mg->copyEnpassantPiece();
-                //std::cout << "Depth " << depth << " making move" << std::endl;
-                //mg->printBitboard(allWhites | allBlacks);
-                //mg->printBoard();
-
-                mg->makeMove(moveList[i]);
-                nodes += perft(mg, depth - 1);
-
-                mg->undoBitboards(bitboards);
-                mg->setAllBlacks(allBlacks);
-                mg->setAllWhites(allWhites);
-                mg->setAllPieces(allBlacks, allWhites);
-                mg->setSide(side);
-                mg->setCastle(castle);
-                mg->setEnpassant(enpassant);
-                mg->setEnpassantPiece(enpassantPiece);
-
-                //std::cout << "Depth " << depth << " undo move" << std::endl;
-                //mg->printBitboard(allWhites | allBlacks);
-                //mg->printBoard();
-            }
-            return nodes;
-        }
-
         //
         // game starting point
         // this is called by the main render loop in main.cpp
@@ -0,0 +1,5 @@
+#include "AttackTables.h"
+
+// Built entirely by the compiler; constinit makes it a compile error if any
+// part of the tables would need to run at startup instead.
+constinit const AttackTables attackTables = AttackTables();
@@ -0,0 +1,414 @@
+#pragma once
+#include <cstdint>
+#include <bit>
+#include "Magics.h"
+#ifdef USE_PEXT
+#include <immintrin.h>
+#endif
+
+#define set_bit(bitboard, square) (((bitboard) |= (1ULL << (square))))
+#define get_bit(bitboard, square) (((bitboard) & (1ULL << (square))))
+#define pop_bit(bitboard, square) ((get_bit(bitboard, square) ? (bitboard) ^= (1ULL << (square)) : 0))
+
+//
+// Precomputed attack lookups for every piece type.
+// None of this depends on the position, so it is built once and shared
+// read-only by every MoveGenerator through attackTables below.
+// Everything here is constexpr: attackTables is evaluated by the compiler
+// and lands in the binary as read-only data, so startup does no table work.
+//
+// Slider lookups are indexed with magic multiplication by default, or with
+// the BMI2 PEXT instruction when built with USE_PEXT (CMake option CHESS_USE_PEXT).
+//
+class AttackTables {
+public:
+    constexpr AttackTables(){
+        initPawnAttacks();
+        initKnightAttacks();
+        initKingAttacks();
+        initSliderAttacks(1);
+        initSliderAttacks(0);
+        initSquaresBetween();
+    };
+
+    // Constants to help check if pawns or knights is on the A/B or H/G files.
+    // Copied from Chess Programming BBC Chess engine
+    static constexpr uint64_t notAFile = 18374403900871474942ULL;
+    static constexpr uint64_t notHFile = 9187201950435737471ULL;
+    static constexpr uint64_t notHGFile = 4557430888798830399ULL;
+    static constexpr uint64_t notABFile = 18229723555195321596ULL;
+
+    // OCCUPANCY BITS: Calculated from the amount of possible attacks for bishops/rooks on a square, excluding the edge (as this is guaranteed)
+    // Copied from Chess Programming's BBC Chess Engine
+
+    // bishop relevant occupancy bit count for every square on board
+    static constexpr int bishop_relevant_bits[64] = {
+        6, 5, 5, 5, 5, 5, 5, 6,
+        5, 5, 5, 5, 5, 5, 5, 5,
+        5, 5, 7, 7, 7, 7, 5, 5,
+        5, 5, 7, 9, 9, 7, 5, 5,
+        5, 5, 7, 9, 9, 7, 5, 5,
+        5, 5, 7, 7, 7, 7, 5, 5,
+        5, 5, 5, 5, 5, 5, 5, 5,
+        6, 5, 5, 5, 5, 5, 5, 6
+    };
+
+    // rook relevant occupancy bit count for every square on board
+    static constexpr int rook_relevant_bits[64] = {
+        12, 11, 11, 11, 11, 11, 11, 12,
+        11, 10, 10, 10, 10, 10, 10, 11,
+        11, 10, 10, 10, 10, 10, 10, 11,
+        11, 10, 10, 10, 10, 10, 10, 11,
+        11, 10, 10, 10, 10, 10, 10, 11,
+        11, 10, 10, 10, 10, 10, 10, 11,
+        11, 10, 10, 10, 10, 10, 10, 11,
+        12, 11, 11, 11, 11, 11, 11, 12
+    };
+
+    //Precomputed square masks
+    // copied from nkarve/surge 's chess engine
+    static constexpr uint64_t SQUARE_BB[65] = {
+        0x1, 0x2, 0x4, 0x8,
+        0x10, 0x20, 0x40, 0x80,
+        0x100, 0x200, 0x400, 0x800,
+        0x1000, 0x2000, 0x4000, 0x8000,
+        0x10000, 0x20000, 0x40000, 0x80000,
+        0x100000, 0x200000, 0x400000, 0x800000,
+        0x1000000, 0x2000000, 0x4000000, 0x8000000,
+        0x10000000, 0x20000000, 0x40000000, 0x80000000,
+        0x100000000, 0x200000000, 0x400000000, 0x800000000,
+        0x1000000000, 0x2000000000, 0x4000000000, 0x8000000000,
+        0x10000000000, 0x20000000000, 0x40000000000, 0x80000000000,
+        0x100000000000, 0x200000000000, 0x400000000000, 0x800000000000,
+        0x1000000000000, 0x2000000000000, 0x4000000000000, 0x8000000000000,
+        0x10000000000000, 0x20000000000000, 0x40000000000000, 0x80000000000000,
+        0x100000000000000, 0x200000000000000, 0x400000000000000, 0x800000000000000,
+        0x1000000000000000, 0x2000000000000000, 0x4000000000000000, 0x8000000000000000,
+        0x0
+    };
+
+    uint64_t pawnAttacks[2][64] = {};
+    uint64_t knightAttacks[64] = {};
+    uint64_t kingAttacks[64] = {};
+
+    uint64_t bishopMasks[64] = {};
+    uint64_t rookMasks[64] = {};
+#ifdef USE_PEXT
+    static constexpr const char* sliderBackend = "pext";
+#else
+    static constexpr const char* sliderBackend = "magic";
+#endif
+
+    // Slider tables are packed: each square only gets the 2^index bits entries
+    // its index can reach, back to back in one array and found through a per-square
+    // offset. PEXT always needs the full relevant bits; magic indexes use the
+    // per-square widths from Magics.h, which can be smaller.
+#ifdef USE_PEXT
+    static constexpr const int (&bishopIndexBits)[64] = bishop_relevant_bits;
+    static constexpr const int (&rookIndexBits)[64] = rook_relevant_bits;
+    static constexpr int bishopTableSize = 5248;
+    static constexpr int rookTableSize = 102400;
+#else
+    static constexpr const int (&bishopIndexBits)[64] = bishop_magic_bits;
+    static constexpr const int (&rookIndexBits)[64] = rook_magic_bits;
+    static constexpr int bishopTableSize = bishop_magic_slots;
+    static constexpr int rookTableSize = rook_magic_slots;
+#endif
+    int bishopOffsets[64] = {};
+    int rookOffsets[64] = {};
+    uint64_t bishopAttacks[bishopTableSize] = {};
+    uint64_t rookAttacks[rookTableSize] = {};
+
+    // lookup table to help with generating legal moves
+    uint64_t squaresBetween[64][64] = {};
+
+    static constexpr int countBits(uint64_t bitboard){
+        return std::popcount(bitboard);
+    }
+
+    static constexpr int getLsb(uint64_t bitboard){
+        if(bitboard){
+            return std::countr_zero(bitboard);
+        }
+        return -1;
+    }
+
+
+    constexpr void initSquaresBetween(){
+        uint64_t commonSquares;
+        for (int sq1 = 0; sq1 < 64; sq1++){
+            for (int sq2 = 0; sq2 < 64; sq2++) {
+                commonSquares = SQUARE_BB[sq1] | SQUARE_BB[sq2];
+                int sq1Rank = sq1/8;
+                int sq1File = sq1%8;
+                int sq2Rank = sq2/8;
+                int sq2File = sq2%8;
+
+                // on horizontal or vertical
+                if (sq1Rank == sq2Rank || sq1File == sq2File)
+                    squaresBetween[sq1][sq2] = generateBlockedRookAttack(sq1, commonSquares) & generateBlockedRookAttack(sq2, commonSquares);
+                // on diagonal
+                else if (sq1Rank - sq2Rank == sq1File - sq2File || sq1Rank - sq2Rank == sq2File - sq1File)
+                    squaresBetween[sq1][sq2] = generateBlockedBishopAttack(sq1, commonSquares) & generateBlockedBishopAttack(sq2, commonSquares);
+            }
+        }
+    }
+
+    static constexpr uint64_t generatePawnAttack(int square, int side){
+        uint64_t attacks = 0;
+        uint64_t bitboard = 0;
+
+        set_bit(bitboard, square);
+
+        //white pawns
+        if(!side){
+            attacks |= ((bitboard >> 7) & notAFile);
+            attacks |= ((bitboard >> 9) & notHFile);
+        }
+        //black pawns
+        else {
+            attacks |= ((bitboard << 7) & notHFile);
+            attacks |= ((bitboard << 9) & notAFile);
+        }
+
+        return attacks;
+    }
+
+    static constexpr uint64_t generateKnightAttack(int square){
+        uint64_t attacks = 0;
+        uint64_t bitboard = 0;
+
+        set_bit(bitboard, square);
+
+        attacks |= ((bitboard >> 15) & notAFile);
+        attacks |= ((bitboard >> 17) & notHFile);
+
+        attacks |= ((bitboard >> 10) & notHGFile);
+        attacks |= ((bitboard >> 6) & notABFile);
+
+        attacks |= ((bitboard << 15) & notHFile);
+        attacks |= ((bitboard << 17) & notAFile);
+
+        attacks |= ((bitboard << 10) & notABFile);
+        attacks |= ((bitboard << 6) & notHGFile);
+
+        return attacks;
+    }
+
+    static constexpr uint64_t generateKingAttack(int square){
+        uint64_t attacks = 0;
+        uint64_t bitboard = 0;
+
+        set_bit(bitboard, square);
+
+        // Up right diagonal
+        attacks |= ((bitboard >> 7) & notAFile);
+        // Up
+        attacks |= (bitboard >> 8);
+        // Up left diagonal
+        attacks |= ((bitboard >> 9) & notHFile);
+
+        // Down left diagonal
+        attacks |= ((bitboard << 7) & notHFile);
+        // Down
+        attacks |= (bitboard << 8);
+        // Down right diagonal
+        attacks |= ((bitboard << 9) & notAFile);
+
+        // Left
+        attacks |= ((bitboard >> 1) & notHFile);
+        // Right
+        attacks |= ((bitboard << 1) & notAFile);
+
+        return attacks;
+    }
+
+    static constexpr uint64_t generateBishopAttack(int square){
+        uint64_t attacks = 0;
+        int r = square / 8;
+        int c = square % 8;
+        int i, j;
+
+        for(i = r + 1, j = c + 1; i <= 6 && j <= 6; i++, j++) attacks |= (1ULL << (i * 8 + j));
+        for(i = r + 1, j = c - 1; i <= 6 && j >= 1; i++, j--) attacks |= (1ULL << (i * 8 + j));
+        for(i = r - 1, j = c + 1; i >= 1 && j <= 6; i--, j++) attacks |= (1ULL << (i * 8 + j));
+        for(i = r - 1, j = c - 1; i >= 1 && j >= 1; i--, j--) attacks |= (1ULL << (i * 8 + j));
+
+        return attacks;
+    }
+
+    static constexpr uint64_t generateRookAttack(int square){
+        uint64_t attacks = 0;
+        int r = square / 8;
+        int c = square % 8;
+        int i, j;
+
+        for(i = r + 1; i <= 6; i++) attacks |= (1ULL << (i * 8 + c));
+        for(i = r - 1; i >= 1; i--) attacks |= (1ULL << (i * 8 + c));
+        for(j = c + 1; j <= 6; j++) attacks |= (1ULL << (r * 8 + j));
+        for(j = c - 1; j >= 1; j--) attacks |= (1ULL << (r * 8 + j));
+
+        return attacks;
+    }
+
+    static constexpr uint64_t generateBlockedBishopAttack(int square, uint64_t blockers){
+        uint64_t attacks = 0;
+        uint64_t attack = 0;
+        int r = square / 8;
+        int c = square % 8;
+        int i, j;
+
+        for(i = r + 1, j = c + 1; i <= 7 && j <= 7; i++, j++){
+            attack = (1ULL << (i * 8 + j));
+            attacks |= attack;
+            if(attack & blockers) break;
+        }
+        for(i = r + 1, j = c - 1; i <= 7 && j >= 0; i++, j--){
+            attack = (1ULL << (i * 8 + j));
+            attacks |= attack;
+            if(attack & blockers) break;
+        }
+        for(i = r - 1, j = c + 1; i >= 0 && j <= 7; i--, j++){
+            attack = (1ULL << (i * 8 + j));
+            attacks |= attack;
+            if(attack & blockers) break;
+        }
+        for(i = r - 1, j = c - 1; i >= 0 && j >= 0; i--, j--){
+            attack = (1ULL << (i * 8 + j));
+            attacks |= attack;
+            if(attack & blockers) break;
+        }
+        return attacks;
+    }
+
+    static constexpr uint64_t generateBlockedRookAttack(int square, uint64_t blockers){
+        uint64_t attacks = 0;
+        uint64_t attack = 0;
+        int r = square / 8;
+        int c = square % 8;
+        int i, j;
+
+        for(i = r + 1; i <= 7; i++){
+            attack = (1ULL << (i * 8 + c));
+            attacks |= attack;
+            if(attack & blockers) break;
+        }
+        for(i = r - 1; i >= 0; i--){
+            attack = (1ULL << (i * 8 + c));
+            attacks |= attack;
+            if(attack & blockers) break;
+        }
+        for(j = c + 1; j <= 7; j++){
+            attack = (1ULL << (r * 8 + j));
+            attacks |= attack;
+            if(attack & blockers) break;
+        }
+        for(j = c - 1; j >= 0; j--){
+            attack = (1ULL << (r * 8 + j));
+            attacks |= attack;
+            if(attack & blockers) break;
+        }
+
+        return attacks;
+    }
+
+    // Set Occupancies: Copied from Chess Programming's BBC Chess Engine
+    static constexpr uint64_t getPossibleOccupancies(int index, int bitsInMask, uint64_t attackMask){
+        uint64_t occupancy = 0;
+
+        for(int count = 0; count < bitsInMask; count++){
+            int square = getLsb(attackMask);
+            pop_bit(attackMask, square);
+
+            if(index & (1 << count))
+                occupancy |= (1ULL << square);
+        }
+
+        return occupancy;
+    }
+
+
+
+    constexpr void initPawnAttacks(){
+        for(int i = 0; i < 64; i++){
+            pawnAttacks[0][i] = generatePawnAttack(i, 0);
+            pawnAttacks[1][i] = generatePawnAttack(i, 1);
+        }
+    }
+    constexpr void initKnightAttacks(){
+        for(int i = 0; i < 64; i++){
+            knightAttacks[i] = generateKnightAttack(i);
+        }
+    }
+    constexpr void initKingAttacks(){
+        for(int i = 0; i < 64; i++){
+            kingAttacks[i] = generateKingAttack(i);
+        }
+    }
+
+    constexpr void initSliderAttacks(int bishop){
+        int offset = 0;
+        for(int square = 0; square < 64; square++){
+
+            // All possible attacks (Except edge)
+            bishopMasks[square] = generateBishopAttack(square);
+            rookMasks[square] = generateRookAttack(square);
+
+            // All possible attacks of the given square (except edge)
+            uint64_t attackMask = bishop ? bishopMasks[square] : rookMasks[square];
+            int indexBits = bishop ? bishopIndexBits[square] : rookIndexBits[square];
+            (bishop ? bishopOffsets : rookOffsets)[square] = offset;
+
+            // Walk every subset of the mask (carry-rippler), which visits the
+            // same occupancies as getPossibleOccupancies without rebuilding each one
+            uint64_t occupancy = 0;
+#ifdef USE_PEXT
+            int subset = 0;
+#endif
+            do {
+#ifdef USE_PEXT
+                // Subsets come out in counting order, so the i-th one is exactly
+                // the occupancy PEXT turns back into index i
+                int index = subset++;
+#else
+                uint64_t magic = bishop ? bishop_magic_numbers[square] : rook_magic_numbers[square];
+                int index = (occupancy * magic) >> (64 - indexBits);
+#endif
+                if(bishop){
+                    bishopAttacks[offset + index] = generateBlockedBishopAttack(square, occupancy);
+                }
+                else {
+                    rookAttacks[offset + index] = generateBlockedRookAttack(square, occupancy);
+                }
+                occupancy = (occupancy - attackMask) & attackMask;
+            } while(occupancy);
+
+            offset += (1 << indexBits);
+        }
+    }
+
+    uint64_t getBishopAttacks(int square, uint64_t occupancy) const {
+#ifdef USE_PEXT
+        uint64_t index = _pext_u64(occupancy, bishopMasks[square]);
+#else
+        uint64_t index = ((occupancy & bishopMasks[square]) * bishop_magic_numbers[square]) >> (64 - bishop_magic_bits[square]);
+#endif
+        return bishopAttacks[bishopOffsets[square] + index];
+    }
+
+    uint64_t getRookAttacks(int square, uint64_t occupancy) const {
+#ifdef USE_PEXT
+        uint64_t index = _pext_u64(occupancy, rookMasks[square]);
+#else
+        uint64_t index = ((occupancy & rookMasks[square]) * rook_magic_numbers[square]) >> (64 - rook_magic_bits[square]);
+#endif
+        return rookAttacks[rookOffsets[square] + index];
+    }
+
+    uint64_t getQueenAttacks(int square, uint64_t occupancy) const {
+        return getBishopAttacks(square, occupancy) | getRookAttacks(square, occupancy);
+    }
+};
+
+// The one process-wide copy of the tables, constant-initialised in AttackTables.cpp
+extern const AttackTables attackTables;
@@ -100,7 +100,7 @@ void Chess::setUpBoard()
     // Set bitboard
     std::string fen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
     _mg->parseFen(fen.c_str());
-    _mg->generateMoves();
+    _mg->generateMoves(_moves);
 
     startGame();
 }
@@ -126,8 +126,8 @@ bool Chess::canBitMoveFromTo(Bit& bit, BitHolder& src, BitHolder& dst)
     ChessSquare &dstSquare = static_cast<ChessSquare&>(dst);
     int dstPos = rowColToPos(dstSquare.getRow(), dstSquare.getColumn());
 
-	for(int i = 0; i < _mg->moveCount; i++){
-		if(srcPos == _mg->getSrc(_mg->moveList[i]) && dstPos == _mg->getDst(_mg->moveList[i])){
+	for(int i = 0; i < _moves.count; i++){
+		if(srcPos == _mg->getSrc(_moves[i]) && dstPos == _mg->getDst(_moves[i])){
             return true;
 		}
 	}
@@ -153,17 +153,22 @@ void Chess::bitMovedFromTo(Bit& bit, BitHolder& src, BitHolder& dst)
     ChessSquare &dstSquare = static_cast<ChessSquare&>(dst);
     int dstPos = rowColToPos(dstSquare.getRow(), dstSquare.getColumn());
 
-	for(int i = 0; i < _mg->moveCount; i++){
-        int move = _mg->moveList[i];
+	for(int i = 0; i < _moves.count; i++){
+        int move = _moves[i];
 		if(srcPos == _mg->getSrc(move) && dstPos == _mg->getDst(move)){
-            if(_mg->getPromotedPiece(move)){
+            // promotions come once per piece, dragging a pawn always queens
+            int promotedPiece = _mg->getPromotedPiece(move);
+            if(promotedPiece && promotedPiece != _mg->Q){
+                continue;
+            }
+            if(promotedPiece){
                 Bit *bit = PieceForPlayer(!_mg->side, Queen);
                 bit->setPosition(_grid[dstSquare.getRow()][dstSquare.getColumn()].getPosition());
                 bit->setParent(&_grid[dstSquare.getRow()][dstSquare.getColumn()]);
                 bit->setGameTag(!_mg->side ? Queen : Queen + 128);
                 _grid[dstSquare.getRow()][dstSquare.getColumn()].setBit( bit );
             }
-            if(_mg->enpassant == dstPos){
+            if(_mg->getEnpassant(move)){
                 _grid[_mg->enpassantPiece / 8][_mg->enpassantPiece % 8].setBit(nullptr);
             }
             if(_mg->getCastle(move)){
@@ -207,10 +212,11 @@ void Chess::bitMovedFromTo(Bit& bit, BitHolder& src, BitHolder& dst)
                 }
             }
 
-            _mg->makeMove(_mg->moveList[i]);
+            _mg->makeMove(move);
+            break;
 		}
 	}
-    _mg->generateMoves();
+    _mg->generateMoves(_moves);
     endTurn();
 }
 
@@ -231,13 +237,15 @@ void Chess::movePiece(int move){
     // check special cases
 
     if(_mg->getPromotedPiece(move)){
-        Bit *bit = PieceForPlayer(!_mg->side, Queen);
+        // engine pieces run P..K from 0, ChessPiece from Pawn = 1
+        ChessPiece promoted = ChessPiece(_mg->getPromotedPiece(move) + 1);
+        Bit *bit = PieceForPlayer(!_mg->side, promoted);
         bit->setPosition(_grid[dstSquare.getRow()][dstSquare.getColumn()].getPosition());
         bit->setParent(&_grid[dstSquare.getRow()][dstSquare.getColumn()]);
-        bit->setGameTag(!_mg->side ? Queen : Queen + 128);
+        bit->setGameTag(!_mg->side ? promoted : promoted + 128);
         _grid[dstSquare.getRow()][dstSquare.getColumn()].setBit( bit );
     }
-    if(_mg->enpassant == dst){
+    if(_mg->getEnpassant(move)){
         _grid[_mg->enpassantPiece / 8][_mg->enpassantPiece % 8].setBit(nullptr);
     }
     if(_mg->getCastle(move)){
@@ -279,7 +287,7 @@ void Chess::movePiece(int move){
         }
     }
     _mg->makeMove(move);
-    _mg->generateMoves();
+    _mg->generateMoves(_moves);
     endTurn();
 }
 
@@ -339,117 +347,32 @@ int Chess::evaluateBoard(const char* stateString){
 
 ChessAI* Chess::clone(){
     ChessAI* ai = new ChessAI();
-    MoveGenerator* mgCopy = new MoveGenerator(*_mg);
-    ai->_mg = mgCopy;
+    ai->_mg = std::make_unique<MoveGenerator>(*_mg);
+    ai->_tt = &_tt;
+    ai->options = _searchOptions;
     return ai;
 }
 
 void Chess::updateAI(){
     std::cout << "calling update ai" << std::endl;
-    //_mg->generateMoves();
-    uint32_t moveList[256];
-    _mg->copyMoveList(moveList);
-    int moveCount = _mg->copyMoveCount();
-    std::cout << "Move count: " << moveCount << std::endl;
-
-    int maxScore = -10000;
-    int maxMove = moveList[0];
-
-    for(int i = 0; i < moveCount; i++){
-
-        ChessAI* ai = this->clone();
-
-        ai->_mg->makeMove(moveList[i]);
-        int score = ai->negamax(-9999, 9999, 2);
-
-        if(score > maxScore){
-            maxScore = score;
-            maxMove = moveList[i];
-        }
-        delete ai;
+    std::cout << "Move count: " << _moves.count << std::endl;
+
+    // iterative deepening on a copy of the board, as deep as the move budget allows
+    ChessAI* ai = this->clone();
+    SearchLimits limits;
+    SearchResult result = ai->search(limits);
+    delete ai;
+
+    _gameOptions.AIDepthSearches = result.depth;
+    std::cout << "depth " << result.depth << " score " << result.score << " nodes " << result.nodes
+              << " (" << result.qnodes << " quiescence) in " << result.ms << " ms, branching factor " << result.branching << std::endl;
+    std::cout << "hash: " << result.tt.hits << " hits of " << result.tt.probes << " probes, "
+              << result.ttFill / 10.0 << "% full" << std::endl;
+    if(!result.move){
+        return;
     }
 
     // Make move
-    movePiece(maxMove);
+    movePiece(result.move);
     _mg->printBoard();
 }
-
-void ChessAI::setBoard(){
-
-}
-
-// returns winner
-int ChessAI::AICheckForWinner(){
-    if(_mg->isCheckmate()){
-        std::cout << "checkmate, side under check" << _mg->side << std::endl;
-        return !_mg->side;
-    }
-    return -1;
-}
-
-int ChessAI::evaluateBoard()
-{
-    if(AICheckForWinner() >= 0){
-        // AI Lost
-        if(_mg->side == AI_PLAYER){
-            return -10;
-        }
-        // AI win
-        else {
-            return 10;
-        }
-    }
-
-    // Evaluate un won board state
-
-    return 0;
-}
-
-int ChessAI::negamax(int alpha, int beta, int depth){
-    // negamax
-    _mg->generateMoves();
-
-    // Return at max depth
-    if(depth == 0){
-        return evaluateBoard();
-    }
-    // Evaluate board
-    int score = evaluateBoard();
-    if(score == 10) return score - depth;
-    else if(score == -10) return score + depth;
-
-    score = -10000;
-
-    uint32_t moveList[256];
-    _mg->copyMoveList(moveList);
-    int moveCount = _mg->copyMoveCount();
-
-    for(int i = 0; i < moveCount; i++){
-        // Copy board state
-        uint64_t bitboards[12];
-        _mg->copyBitboards(bitboards);
-        uint64_t allBlacks = _mg->copyAllBlacks();
-        uint64_t allWhites = _mg->copyAllWhites();
-        int side = _mg->copySide();
-        int castle = _mg->copyCastle();
-        int enpassant = _mg->copyEnpassant();
-        int enpassantPiece = _mg->copyEnpassantPiece();
-        _mg->makeMove(moveList[i]);
-
-        int current = -negamax(-alpha, -beta, depth - 1);
-
-        if(current > score){
-            score = current;
-        }
-
-        _mg->undoBitboards(bitboards);
-        _mg->setAllBlacks(allBlacks);
-        _mg->setAllWhites(allWhites);
-        _mg->setAllPieces(allBlacks, allWhites);
-        _mg->setSide(side);
-        _mg->setCastle(castle);
-        _mg->setEnpassant(enpassant);
-        _mg->setEnpassantPiece(enpassantPiece);
-    }
-    return score;
-}
\ No newline at end of file
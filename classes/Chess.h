@@ -1,6 +1,7 @@
 #pragma once
 #include "Game.h"
 #include "ChessSquare.h"
+#include "ChessAI.h"
 
 //
 // the classic game of chess
@@ -14,16 +15,6 @@ enum ChessPiece {
     King
 };
 
-class ChessAI
-{
-public:
-    void setBoard();
-    int evaluateBoard();
-    int negamax(int alpha, int beta, int depth);
-    int AICheckForWinner();
-
-    MoveGenerator* _mg;
-};
 //
 // the main game class
 //
@@ -56,6 +47,9 @@ public:
     //ai functions
     ChessAI* clone();
     void updateAI() override;
+    // transposition table size, emptying it
+    void setHashSize(size_t megabytes) { _tt.resize(megabytes); }
+    void setSearchOptions(const SearchOptions& options) { _searchOptions = options; }
 
 private:
     const char  bitToPieceNotation(int row, int column) const;
@@ -68,5 +62,9 @@ private:
     uint64_t    w_board;
     uint64_t    b_board;
 
+    // what the AI has searched so far, kept across its moves
+    TranspositionTable  _tt{16};
+    SearchOptions       _searchOptions;
+
 
 };
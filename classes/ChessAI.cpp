@@ -0,0 +1,458 @@
+#include "ChessAI.h"
+#include "MovePicker.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+void ChessAI::setBoard(){
+
+}
+
+// returns winner
+int ChessAI::AICheckForWinner(){
+    if(_mg->isCheckmate()){
+        std::cout << "checkmate, side under check" << _mg->side << std::endl;
+        return !_mg->side;
+    }
+    return -1;
+}
+
+// material balance for the side to move, in the same centipawns as the static exchange.
+// Mates are found by the search, which knows when there's no move
+int ChessAI::evaluateBoard()
+{
+    int score = 0;
+    for(int piece = MoveGenerator::P; piece < MoveGenerator::K; piece++){
+        score += MoveGenerator::seeValues[piece]
+               * (_mg->countBits(_mg->bitboards[piece]) - _mg->countBits(_mg->bitboards[piece + 6]));
+    }
+    return _mg->side == MoveGenerator::white ? score : -score;
+}
+
+// Mate scores count plies from the root, but a table entry can be reached at any ply,
+// so they are stored counting from the entry's position instead
+int ChessAI::scoreToTable(int score){
+    if(score >= mateScore - maxPly){
+        return score + _ply;
+    }
+    if(score <= -mateScore + maxPly){
+        return score - _ply;
+    }
+    return score;
+}
+
+int ChessAI::scoreFromTable(int score){
+    if(score >= mateScore - maxPly){
+        return score - _ply;
+    }
+    if(score <= -mateScore + maxPly){
+        return score + _ply;
+    }
+    return score;
+}
+
+// checked every 1024 nodes, reading the clock costs more than a node
+bool ChessAI::outOfTime(){
+    if(!_stopped && (nodes & 1023) == 0 && Clock::now() >= _hardDeadline){
+        _stopped = true;
+    }
+    return _stopped;
+}
+
+// plies late move reductions take off, growing with the log of both the depth
+// left and how far down the ordering the move is
+static int lateMoveReduction(int depth, int moveNumber){
+    static const auto table = []{
+        std::array<std::array<int, 64>, 64> reductions{};
+        for(int d = 1; d < 64; d++){
+            for(int m = 1; m < 64; m++){
+                reductions[d][m] = int(0.75 + std::log(d) * std::log(m) / 2.25);
+            }
+        }
+        return reductions;
+    }();
+    return table[std::min(depth, 63)][std::min(moveNumber, 63)];
+}
+
+// knights, bishops, rooks or queens for the side to move. With only pawns and a king,
+// zugzwang is common and passing can look better than any real move
+bool ChessAI::hasPieces(){
+    int own = _mg->side == MoveGenerator::white ? MoveGenerator::P : MoveGenerator::p;
+    return _mg->bitboards[MoveGenerator::N + own] | _mg->bitboards[MoveGenerator::B + own]
+         | _mg->bitboards[MoveGenerator::R + own] | _mg->bitboards[MoveGenerator::Q + own];
+}
+
+//
+// Fail-soft alpha-beta: the score returned can lie outside alpha..beta, a bound on the
+// real one that the table can use. Moves come hash move first, then captures by
+// MVV-LVA, the killers of this ply and quiets by history, so a cutoff usually comes early.
+//
+// Only the first move is searched with the full window. The rest are expected to be
+// worse, so a zero window just checks that, and only one that beats alpha is searched again.
+//
+// The search is selective where options allow, outside the principal variation and
+// never in check:
+//   - futility: a node near the horizon whose evaluation is already a margin above
+//     beta returns it, and below alpha quiet moves that don't give check are skipped
+//   - razoring: a node near the horizon far enough below alpha that quiescence
+//     agrees fails low
+//   - null move: if passing still fails high at reduced depth, a real move would too.
+//     Not with only pawns, never twice in a row, and checked again when deep
+//   - late move reductions: quiet moves late in the ordering are searched less deep,
+//     and searched again at full depth if they beat alpha anyway
+//
+int ChessAI::negamax(int alpha, int beta, int depth, bool allowNull){
+    // the horizon: settle the captures before trusting the evaluation.
+    // quiescence counts the node, so it isn't counted twice
+    if(depth <= 0){
+        return quiescence(alpha, beta);
+    }
+
+    nodes++;
+    if(outOfTime()){
+        return 0;
+    }
+    if(_ply >= maxPly){
+        return evaluateBoard();
+    }
+
+    // a position searched before: its best move goes first, and a deep enough
+    // score that is exact or outside the window ends it here
+    int alphaOriginal = alpha;
+    uint16_t hashMove = 0;
+    if(_tt){
+        TTEntry entry;
+        ttStats.probes++;
+        if(_tt->probe(_mg->hash, entry)){
+            ttStats.hits++;
+            hashMove = entry.move;
+            int tableScore = scoreFromTable(entry.score);
+            if(entry.depth >= depth && (entry.bound == TranspositionTable::exactBound
+                || (entry.bound == TranspositionTable::lowerBound && tableScore >= beta)
+                || (entry.bound == TranspositionTable::upperBound && tableScore <= alpha))){
+                return tableScore;
+            }
+        }
+    }
+
+    bool pvNode = beta - alpha > 1;
+    bool inCheck = _mg->inCheck();
+    int staticEval = inCheck ? -infinity : evaluateBoard();
+    bool nearHorizon = !pvNode && !inCheck && depth <= frontierDepth;
+
+    if(options.futility && nearHorizon && std::abs(beta) < mateScore - maxPly && staticEval - futilityMargin * depth >= beta){
+        return staticEval;
+    }
+    if(options.razoring && nearHorizon && staticEval + razorMargin * depth <= alpha){
+        int score = quiescence(alpha, beta);
+        if(score <= alpha){
+            return score;
+        }
+    }
+
+    if(options.nullMove && allowNull && !pvNode && !inCheck && depth >= 3 && staticEval >= beta && hasPieces()){
+        // adaptive: deeper nodes can afford a bigger reduction
+        int reduction = depth > 6 ? 3 : 2;
+        _mg->makeNullMove(_undo[_ply]);
+        _ply++;
+        int score = -negamax(-beta, -beta + 1, depth - 1 - reduction, false);
+        _ply--;
+        _mg->unmakeNullMove(_undo[_ply]);
+        if(_stopped){
+            return 0;
+        }
+        if(score >= beta){
+            // a mate found after passing isn't one
+            if(score >= mateScore - maxPly){
+                score = beta;
+            }
+            if(depth < nullVerifyDepth){
+                return score;
+            }
+            int verified = negamax(beta - 1, beta, depth - 1 - reduction, false);
+            if(_stopped){
+                return 0;
+            }
+            if(verified >= beta){
+                return score;
+            }
+        }
+    }
+
+    // below alpha by more than a quiet move could make up
+    bool futile = options.futility && nearHorizon && std::abs(alpha) < mateScore - maxPly && staticEval + futilityMargin * depth <= alpha;
+
+    int score = -infinity;
+    uint16_t bestMove = 0;
+    int movesPlayed = 0;
+
+    // moves come in stages, so a node only generates what it gets through
+    MovePicker picker(_mg.get(), hashMove, _killers[_ply], _history[_mg->side]);
+    for(uint16_t move = picker.next(); move; move = picker.next()){
+        movesPlayed++;
+        bool quiet = !_mg->getCapture(move) && !_mg->getPromotedPiece(move);
+        _mg->makeMove(move, _undo[_ply]);
+        bool givesCheck = _mg->inCheck();
+
+        if(futile && quiet && movesPlayed > 1 && !givesCheck){
+            _mg->unmakeMove(move, _undo[_ply]);
+            score = std::max(score, staticEval + futilityMargin * depth);
+            continue;
+        }
+        _ply++;
+
+        int current;
+        if(movesPlayed == 1){
+            current = -negamax(-beta, -alpha, depth - 1);
+        }
+        else {
+            int reduction = 0;
+            if(options.lateMoveReductions && depth >= 3 && movesPlayed > 3 && !inCheck && !givesCheck
+                && picker.stage() == MovePicker::quietStage){
+                reduction = std::clamp(lateMoveReduction(depth, movesPlayed) - pvNode, 0, depth - 2);
+            }
+            current = -negamax(-alpha - 1, -alpha, depth - 1 - reduction);
+            if(current > alpha && reduction){
+                current = -negamax(-alpha - 1, -alpha, depth - 1);
+            }
+            if(current > alpha && current < beta){
+                current = -negamax(-beta, -alpha, depth - 1);
+            }
+        }
+
+        _ply--;
+        _mg->unmakeMove(move, _undo[_ply]);
+        if(_stopped){
+            return 0;
+        }
+
+        if(current > score){
+            score = current;
+            bestMove = move;
+            if(current > alpha){
+                alpha = current;
+            }
+        }
+        // the opponent won't allow this position, the rest can't matter
+        if(alpha >= beta){
+            if(quiet){
+                quietCutoff(move, depth);
+            }
+            break;
+        }
+    }
+
+    // No moves: checkmate or stalemate
+    if(!movesPlayed){
+        return inCheck ? -mateScore + _ply : 0;
+    }
+    if(_tt){
+        int bound = score >= beta ? TranspositionTable::lowerBound
+                  : score > alphaOriginal ? TranspositionTable::exactBound : TranspositionTable::upperBound;
+        ttStats.stores++;
+        _tt->store(_mg->hash, bestMove, scoreToTable(score), depth, bound);
+    }
+    return score;
+}
+
+//
+// Quiescence: below the horizon only captures and queening are searched, until the
+// position is quiet enough for evaluateBoard to mean something. The side to move can
+// stand pat on the evaluation instead of capturing, so that's the floor of the score.
+// Captures that lose material by static exchange are never tried, nor ones that
+// can't lift the score back to alpha even winning the piece and deltaMargin more.
+// In check there's no standing pat: every evasion is searched and no move is mate.
+//
+int ChessAI::quiescence(int alpha, int beta){
+    nodes++;
+    qnodes++;
+    if(outOfTime()){
+        return 0;
+    }
+    if(_ply >= maxPly){
+        return evaluateBoard();
+    }
+
+    bool inCheck = _mg->inCheck();
+    int score = -infinity;
+    if(!inCheck){
+        score = evaluateBoard();
+        if(score >= beta){
+            return score;
+        }
+        alpha = std::max(alpha, score);
+    }
+    int standPat = score;
+
+    int movesPlayed = 0;
+    MovePicker picker = inCheck ? MovePicker(_mg.get(), 0, nullptr) : MovePicker(_mg.get());
+    for(uint16_t move = picker.next(); move; move = picker.next()){
+        movesPlayed++;
+        if(!inCheck && !_mg->getPromotedPiece(move) && standPat + _mg->captureGain(move) + deltaMargin <= alpha){
+            continue;
+        }
+        _mg->makeMove(move, _undo[_ply]);
+        _ply++;
+
+        int current = -quiescence(-beta, -alpha);
+
+        _ply--;
+        _mg->unmakeMove(move, _undo[_ply]);
+        if(_stopped){
+            return 0;
+        }
+
+        if(current > score){
+            score = current;
+            if(current > alpha){
+                alpha = current;
+            }
+        }
+        if(alpha >= beta){
+            break;
+        }
+    }
+
+    if(inCheck && !movesPlayed){
+        return -mateScore + _ply;
+    }
+    return score;
+}
+
+// a quiet move refuted this node: make it a killer here and raise its history
+void ChessAI::quietCutoff(uint16_t move, int depth){
+    uint16_t* killers = _killers[_ply];
+    if(killers[0] != move){
+        killers[1] = killers[0];
+        killers[0] = move;
+    }
+    int& history = _history[_mg->side][_mg->getSrc(move)][_mg->getDst(move)];
+    history += depth * depth;
+    // keep the numbers in range, halving all keeps their order
+    if(history > (1 << 20)){
+        for(auto& from : _history[_mg->side]){
+            for(int& to : from){
+                to /= 2;
+            }
+        }
+    }
+}
+
+//
+// One iteration: every root move searched to depth. The moves are searched in list
+// order, and search puts the last iteration's best first, so even an iteration the
+// clock cuts short has a result worth keeping if it got through that move.
+// Returns false when it was cut short.
+//
+bool ChessAI::searchRoot(MoveList& rootMoves, int depth, uint16_t& bestMove, int& bestScore){
+    int alpha = -infinity;
+    bestMove = 0;
+    bestScore = -infinity;
+    for(uint16_t move : rootMoves){
+        _mg->makeMove(move, _undo[_ply]);
+        _ply++;
+        // the first move sets alpha, the others only need to show they don't beat it
+        int score = move == rootMoves[0] ? -negamax(-infinity, -alpha, depth - 1)
+                                         : -negamax(-alpha - 1, -alpha, depth - 1);
+        if(move != rootMoves[0] && score > alpha && !_stopped){
+            score = -negamax(-infinity, -alpha, depth - 1);
+        }
+        _ply--;
+        _mg->unmakeMove(move, _undo[_ply]);
+
+        // the move's subtree was cut off, its score means nothing
+        if(_stopped){
+            return false;
+        }
+        if(score > bestScore){
+            bestScore = score;
+            bestMove = move;
+            alpha = std::max(alpha, score);
+        }
+    }
+    return true;
+}
+
+//
+// Iterative deepening: search depth 1, 2, 3... until the time runs out, keeping the
+// best move of the deepest iteration. No new iteration starts after the soft limit,
+// since it would take longer than all the ones before it; the hard limit stops the
+// search wherever it is. A best move that has held for several iterations stops
+// the search at half the soft limit.
+//
+SearchResult ChessAI::search(const SearchLimits& limits){
+    Clock::time_point start = Clock::now();
+    _hardDeadline = start + std::chrono::microseconds((int64_t)(limits.hardMs * 1000));
+    _stopped = false;
+    _ply = 0;
+    nodes = 0;
+    qnodes = 0;
+    ttStats = TTStats();
+    if(_tt){
+        _tt->newSearch();
+    }
+    // killers are for the position searched last time; history is still worth something, just less
+    std::memset(_killers, 0, sizeof(_killers));
+    for(auto& sideHistory : _history){
+        for(auto& from : sideHistory){
+            for(int& to : from){
+                to /= 8;
+            }
+        }
+    }
+
+    SearchResult result;
+    MoveList rootMoves;
+    _mg->generateMoves(rootMoves);
+    if(!rootMoves.count){
+        return result;
+    }
+    // something legal to play even if the first iteration doesn't finish
+    result.move = rootMoves[0];
+
+    int stableIterations = 0;
+    uint64_t lastIterationNodes = 0;
+    for(int depth = 1; depth <= std::min(limits.maxDepth, maxPly); depth++){
+        std::swap(rootMoves.moves[0], *std::find(rootMoves.begin(), rootMoves.end(), result.move));
+
+        uint16_t bestMove;
+        int bestScore;
+        bool finished = searchRoot(rootMoves, depth, bestMove, bestScore);
+        if(bestMove){
+            stableIterations = bestMove == result.move ? stableIterations + 1 : 0;
+            result.move = bestMove;
+            result.score = bestScore;
+        }
+        if(!finished){
+            break;
+        }
+        result.depth = depth;
+        uint64_t iterationNodes = nodes - result.nodes;
+        result.nodes = nodes;
+        if(lastIterationNodes){
+            result.branching = double(iterationNodes) / lastIterationNodes;
+        }
+        lastIterationNodes = iterationNodes;
+
+        // nothing to choose between, or a forced mate either way that deeper won't change
+        if(rootMoves.count == 1 || std::abs(bestScore) >= mateScore - maxPly){
+            break;
+        }
+        double elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        double softMs = stableIterations >= 3 ? limits.softMs / 2 : limits.softMs;
+        if(elapsedMs >= softMs){
+            break;
+        }
+    }
+
+    result.nodes = nodes;
+    result.qnodes = qnodes;
+    result.tt = ttStats;
+    result.ttFill = _tt ? _tt->fill() : 0;
+    result.ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    _hardDeadline = Clock::time_point::max();
+    return result;
+}
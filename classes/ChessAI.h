@@ -0,0 +1,101 @@
+#pragma once
+#include <chrono>
+#include <memory>
+#include "MoveGenerator.h"
+#include "TranspositionTable.h"
+
+// how long the AI may think about one move
+struct SearchLimits {
+    double softMs = 500;    // no new iteration is started after this
+    double hardMs = 1000;   // the search stops here even in the middle of an iteration
+    int    maxDepth = 64;
+};
+
+// the selective parts of the search, each can be turned off to measure what it buys
+struct SearchOptions {
+    bool nullMove = true;           // give the opponent a free move, if that still fails high so will a real one
+    bool lateMoveReductions = true; // search quiet moves late in the ordering less deep
+    bool futility = true;           // near the horizon, skip quiet moves too far below alpha and nodes too far above beta
+    bool razoring = true;           // near the horizon, hand nodes far below alpha to quiescence
+};
+
+// what search came back with. move is 0 only when there was no legal move
+struct SearchResult {
+    uint16_t move = 0;
+    int      score = 0;
+    int      depth = 0;     // last iteration that finished
+    uint64_t nodes = 0;
+    uint64_t qnodes = 0;    // the part of nodes spent in quiescence
+    double   ms = 0;
+    TTStats  tt;            // zero without a table
+    int      ttFill = 0;    // per mille of the table this search wrote
+    double   branching = 0; // effective branching factor: last iteration's nodes over the one before
+};
+
+//
+// the chess AI works on its own copy of the position so it can search
+// without touching the board on screen. it doesn't depend on ImGui, so the
+// headless tools can run it too.
+//
+class ChessAI
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // scores are from the side to move's point of view. being mated scores
+    // -mateScore plus the plies it takes, so a quicker mate is preferred
+    static constexpr int mateScore = 30000;
+    static constexpr int infinity = 32000;
+    static constexpr int maxPly = 128;
+    // how much more than the captured piece a capture could swing the position,
+    // quiescence skips captures that can't bring alpha back within it
+    static constexpr int deltaMargin = 200;
+    // futility pruning and razoring only look this far from the horizon, with margins
+    // that grow by their value per ply
+    static constexpr int frontierDepth = 2;
+    static constexpr int futilityMargin = 200;
+    static constexpr int razorMargin = 300;
+    // a null move that fails high this deep is checked by a search without one,
+    // in case the side to move is in zugzwang
+    static constexpr int nullVerifyDepth = 7;
+
+    void setBoard();
+    int evaluateBoard();
+    // allowNull is false right after a null move, so two are never played in a row
+    int negamax(int alpha, int beta, int depth, bool allowNull = true);
+    int quiescence(int alpha, int beta);
+    int AICheckForWinner();
+    SearchResult search(const SearchLimits& limits);
+
+    // the AI's own copy of the position
+    std::unique_ptr<MoveGenerator> _mg;
+    // negamax and quiescence calls since the last reset, for measuring search speed
+    uint64_t nodes = 0;
+    // just the quiescence calls, to see how much of the tree is capture sequences
+    uint64_t qnodes = 0;
+    // shared with the game so it lasts from move to move, none if null
+    TranspositionTable* _tt = nullptr;
+    TTStats ttStats;
+    SearchOptions options;
+
+private:
+    bool searchRoot(MoveList& rootMoves, int depth, uint16_t& bestMove, int& bestScore);
+    bool outOfTime();
+    void quietCutoff(uint16_t move, int depth);
+    int scoreToTable(int score);
+    int scoreFromTable(int score);
+    bool hasPieces();
+
+    // plies from the root of the current search
+    int _ply = 0;
+    // what unmakeMove needs for the move made at each ply
+    MoveGenerator::UndoRecord _undo[maxPly];
+    // quiet moves that caused a beta cutoff at each ply, the newest first
+    uint16_t _killers[maxPly][2] = {};
+    // butterfly history: for each side, from and to square, how much quiet moves there
+    // have caused cutoffs, weighted by depth
+    int _history[2][64][64] = {};
+    // set once the hard limit has passed, everything searched after that is thrown away
+    bool _stopped = false;
+    Clock::time_point _hardDeadline = Clock::time_point::max();
+};
@@ -288,9 +288,9 @@ void Game::mouseDown( ImVec2& location, Entity* entity )
 
 	int square = src.getRow() * 8 + src.getColumn();
 
-	for(int i = 0; i < _mg->moveCount; i++){
-		if(square == _mg->getSrc(_mg->moveList[i])){
-			int dst = _mg->getDst(_mg->moveList[i]);
+	for(int i = 0; i < _moves.count; i++){
+		if(square == _mg->getSrc(_moves[i])){
+			int dst = _mg->getDst(_moves[i]);
 			ChessSquare &temp = static_cast<ChessSquare &>(getHolderAt(dst % 8, dst / 8));
 			temp.setMoveHighlighted(true);
 		}
@@ -109,6 +109,8 @@ public:
 
 	GameOptions				_gameOptions;
 	MoveGenerator           *_mg;
+	// legal moves of the position on the board, for dragging and highlighting
+	MoveList                _moves;
 protected:
 	void 					mouseDown( ImVec2& location, Entity* bit );
 	void 					mouseMoved( ImVec2& location, Entity* bit );
@@ -0,0 +1,169 @@
+#pragma once
+#include <cstdint>
+
+//
+// Magic numbers for the slider attack tables.
+// Generated by the magics tool (tools/magics.cpp), run it again instead of editing by hand.
+// The bits arrays give each square's index width, so squares the search could
+// shrink below their relevant occupancy bits take a smaller slice of the table.
+//
+
+inline constexpr int rook_magic_bits[64] = {
+    12, 11, 11, 11, 11, 11, 11, 12,
+    11, 10, 10, 10, 10, 10, 10, 11,
+    11, 10, 10, 10, 10, 10, 10, 11,
+    11, 10, 10, 10, 10, 10, 10, 11,
+    11, 10, 10, 10, 10, 10, 10, 11,
+    11, 10, 10, 10, 10, 10, 10, 11,
+    11, 10, 10, 10, 10, 10, 10, 11,
+    12, 11, 11, 11, 11, 11, 11, 12
+};
+
+inline constexpr uint64_t rook_magic_numbers[64] = {
+    0x80008020400016ULL,
+    0x4140200050014000ULL,
+    0x200120008204080ULL,
+    0x500041001010820ULL,
+    0x200020009200410ULL,
+    0x200011004020008ULL,
+    0x8080020001000080ULL,
+    0x200040080402201ULL,
+    0xa20800040008026ULL,
+    0x8000c04000201000ULL,
+    0x15002004130044ULL,
+    0x104800800100084ULL,
+    0x21000801001004ULL,
+    0x8112000200041088ULL,
+    0x400808002000100ULL,
+    0xc08600110a084084ULL,
+    0x1180024000200040ULL,
+    0x420008020401080ULL,
+    0xa0008010002080ULL,
+    0x8908090010002103ULL,
+    0x2024808008000400ULL,
+    0x431080120041040ULL,
+    0x4040010080102ULL,
+    0x1009020000410084ULL,
+    0x6410200228201ULL,
+    0x8443400300208100ULL,
+    0x110091280200080ULL,
+    0x8450028280080030ULL,
+    0x6000080080040080ULL,
+    0x8001000900040002ULL,
+    0x600420400102148ULL,
+    0x7500044200092384ULL,
+    0x5220004000808000ULL,
+    0x884008802002ULL,
+    0x10040800200020ULL,
+    0x410001080800800ULL,
+    0x8000400800880ULL,
+    0x200e1040080104a0ULL,
+    0x8050011004000802ULL,
+    0x400010082000044ULL,
+    0x100400020918000ULL,
+    0x8150002000504004ULL,
+    0x24410020090010ULL,
+    0x4080080010008080ULL,
+    0x80004008080ULL,
+    0x2020004008080ULL,
+    0x401020004010100ULL,
+    0x804084020021ULL,
+    0x8842220d0200ULL,
+    0x401000200040ULL,
+    0x9840200010008080ULL,
+    0x109000c811610100ULL,
+    0x5248008008040080ULL,
+    0x4003020004008080ULL,
+    0x2011000a00040900ULL,
+    0x5024005c00810200ULL,
+    0x8100800100136441ULL,
+    0x142100420286ULL,
+    0x80c4100200111ULL,
+    0x102100004200901ULL,
+    0x5422011020080402ULL,
+    0x92000810c10402ULL,
+    0x20088011004ULL,
+    0x1010020490c0082ULL
+};
+
+inline constexpr int bishop_magic_bits[64] = {
+    6, 5, 5, 5, 5, 5, 5, 6,
+    5, 5, 5, 5, 5, 5, 5, 5,
+    5, 5, 7, 7, 7, 7, 5, 5,
+    5, 5, 7, 9, 9, 7, 5, 5,
+    5, 5, 7, 9, 9, 7, 5, 5,
+    5, 5, 7, 7, 7, 7, 5, 5,
+    5, 5, 5, 5, 5, 5, 5, 5,
+    6, 5, 5, 5, 5, 5, 5, 6
+};
+
+inline constexpr uint64_t bishop_magic_numbers[64] = {
+    0x2421010408004044ULL,
+    0x1290820200520401ULL,
+    0x804044400409000ULL,
+    0x4004040088214444ULL,
+    0x4001104102140000ULL,
+    0x401142024004011ULL,
+    0x58008a1022608800ULL,
+    0x5204110108024008ULL,
+    0x202002208905ULL,
+    0x10401808280c6540ULL,
+    0x1040c2034041ULL,
+    0x250444408800828ULL,
+    0x1280108820204020ULL,
+    0x2010460044800ULL,
+    0x1000910118624042ULL,
+    0x880102840402b200ULL,
+    0xa040408454080640ULL,
+    0x888402008088090ULL,
+    0x20100b001082301ULL,
+    0x1044000824011100ULL,
+    0x84000206110812ULL,
+    0x80a000100808440ULL,
+    0x408005c240400ULL,
+    0x202000230860800ULL,
+    0x2060843006060cULL,
+    0x8194a00182a20400ULL,
+    0x410410030050200ULL,
+    0x410040000401020ULL,
+    0x21001001004002ULL,
+    0x8002202008404ULL,
+    0xc004040440420205ULL,
+    0x1102020000308200ULL,
+    0x130452004040802ULL,
+    0x1018860208800ULL,
+    0x4040402021020ULL,
+    0x2080040400080210ULL,
+    0x10008200042200ULL,
+    0x820401c0081800ULL,
+    0x31082610808201ULL,
+    0x10200820b802200ULL,
+    0x4001412010c02002ULL,
+    0x802090413182002ULL,
+    0x8102002201000802ULL,
+    0x201202018002100ULL,
+    0x2480404102110100ULL,
+    0x82052208020401c0ULL,
+    0xa042481850840100ULL,
+    0x104080061000040ULL,
+    0x406011002110028ULL,
+    0x110c0201042091ULL,
+    0x208208190422ULL,
+    0x604000205040002ULL,
+    0x1000202810340580ULL,
+    0x6080043528060040ULL,
+    0x20110202180a0202ULL,
+    0x20040400404800ULL,
+    0x4002004044100802ULL,
+    0x4010048020800ULL,
+    0x1041110201012120ULL,
+    0x100082004840440ULL,
+    0x1088240050100ULL,
+    0x120604490008aULL,
+    0x120200414080850ULL,
+    0x4040800440284ULL
+};
+
+// table entries needed for the bits above
+inline constexpr int rook_magic_slots = 102400;
+inline constexpr int bishop_magic_slots = 5248;
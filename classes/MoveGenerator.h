@@ -1,44 +1,55 @@
 #pragma once
 #include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <string>
 #include <iterator>
 #include <algorithm>
 #include <cmath>
-
-#define set_bit(bitboard, square) ((bitboard |= (1ULL << square)))
-#define get_bit(bitboard, square) ((bitboard & (1ULL << square)))
-#define pop_bit(bitboard, square) ((get_bit(bitboard, square) ? bitboard ^= (1ULL << square) : 0))
-
+#include "AttackTables.h"
+#include "ZobristKeys.h"
+
+//
+// Moves of one position, filled in by MoveGenerator::generateMoves.
+// Callers keep it on their own stack, so each ply of a search has its own
+// list and nothing has to be copied before recursing.
+//
+struct MoveList {
+    // the most legal moves any chess position has
+    static constexpr int maxMoves = 218;
+    static constexpr bool countOnly = false;
+
+    uint16_t moves[maxMoves];
+    // not a 16-bit count: a store to a uint16_t may alias an int16_t, so the compiler
+    // would reload count from memory after every add
+    int count = 0;
+
+    void add(uint16_t move){ moves[count++] = move; }
+    uint16_t operator[](int i) const { return moves[i]; }
+    uint16_t* begin(){ return moves; }
+    uint16_t* end(){ return moves + count; }
+};
+
+//
+// Stands in for a MoveList when only the number of legal moves matters, for perft
+// leaves and mobility. The generator then popcounts each piece's target squares
+// instead of encoding and storing a move per square.
+//
+struct MoveCount {
+    static constexpr bool countOnly = true;
+    int count = 0;
+};
+
+//
+// Per-position state and move generation.
+// The attack lookups live in the shared attackTables, so copying a
+// MoveGenerator only copies the board itself.
+//
 class MoveGenerator {
 public:
-    MoveGenerator(){
-        initPawnAttacks();
-        initKnightAttacks();
-        initKingAttacks();
-        initSliderAttacks(1);
-        initSliderAttacks(0);
-        initSquaresBetween();
-    };
+    MoveGenerator(){};
     ~MoveGenerator(){};
-    MoveGenerator(MoveGenerator& other){
-        for(int i = 0; i < 12; i++){
-            bitboards[i] = other.bitboards[i];
-        }
-
-        uint64_t allBlacks = other.allBlacks;
-        uint64_t allWhites = other.allWhites;
-        int side = other.side;
-        int castle = other.castle;
-        int enpassant = other.enpassant;
-        uint64_t enpassantPiece = other.enpassantPiece;
-
-        initPawnAttacks();
-        initKnightAttacks();
-        initKingAttacks();
-        initSliderAttacks(1);
-        initSliderAttacks(0);
-        initSquaresBetween();
-    }
+    MoveGenerator(const MoveGenerator& other) = default;
 
     enum {
         a8, b8, c8, d8, e8, f8, g8, h8,
@@ -59,567 +70,633 @@ public:
         white, black
     };
 
+    // Which moves generateMoves produces. Captures also take every promotion and
+    // en passant, quiets everything else, so together they make up allMoves
+    enum {
+        allMoves, captureMoves, quietMoves
+    };
+
     // Enums for castling
     enum {
         wk = 1, wq = 2, bk = 4, bq = 8
     };
 
     // ASCII pieces
-    char ascii_pieces[13] = "PNBRQKpnbrqk";
-
-    // Constants to help check if pawns or knights is on the A/B or H/G files.
-    // Copied from Chess Programming BBC Chess engine
-    const uint64_t notAFile = 18374403900871474942;
-    const uint64_t notHFile = 9187201950435737471;
-    const uint64_t notHGFile = 4557430888798830399;
-    const uint64_t notABFile = 18229723555195321596;
-
-    // OCCUPANCY BITS: Calculated from the amount of possible attacks for bishops/rooks on a square, excluding the edge (as this is guaranteed)
-    // Copied from Chess Programming's BBC Chess Engine
-
-    // bishop relevant occupancy bit count for every square on board
-    const int bishop_relevant_bits[64] = {
-        6, 5, 5, 5, 5, 5, 5, 6,
-        5, 5, 5, 5, 5, 5, 5, 5,
-        5, 5, 7, 7, 7, 7, 5, 5,
-        5, 5, 7, 9, 9, 7, 5, 5,
-        5, 5, 7, 9, 9, 7, 5, 5,
-        5, 5, 7, 7, 7, 7, 5, 5,
-        5, 5, 5, 5, 5, 5, 5, 5,
-        6, 5, 5, 5, 5, 5, 5, 6
-    };
+    static constexpr char ascii_pieces[13] = "PNBRQKpnbrqk";
+
+    static constexpr uint64_t blackPawns   = 0x000000000000ff00;
+    static constexpr uint64_t whitePawns   = 0x00ff000000000000;
+    static constexpr uint64_t blackKnights = 0x0000000000000042;
+    static constexpr uint64_t whiteKnights = 0x4200000000000000;
+    static constexpr uint64_t blackBishops = 0x0000000000000024;
+    static constexpr uint64_t whiteBishops = 0x2400000000000000;
+    static constexpr uint64_t blackRooks   = 0x0000000000000081;
+    static constexpr uint64_t whiteRooks   = 0x8100000000000000;
+    static constexpr uint64_t blackQueens  = 0x0000000000000008;
+    static constexpr uint64_t whiteQueens  = 0x0800000000000000;
+    static constexpr uint64_t blackKing    = 0x0000000000000010;
+    static constexpr uint64_t whiteKing    = 0x1000000000000000;
 
-    // rook relevant occupancy bit count for every square on board
-    const int rook_relevant_bits[64] = {
-        12, 11, 11, 11, 11, 11, 11, 12,
-        11, 10, 10, 10, 10, 10, 10, 11,
-        11, 10, 10, 10, 10, 10, 10, 11,
-        11, 10, 10, 10, 10, 10, 10, 11,
-        11, 10, 10, 10, 10, 10, 10, 11,
-        11, 10, 10, 10, 10, 10, 10, 11,
-        11, 10, 10, 10, 10, 10, 10, 11,
-        12, 11, 11, 11, 11, 11, 11, 12
-    };
+    uint64_t allWhites = whitePawns | whiteRooks | whiteKnights | whiteBishops | whiteQueens | whiteKing;
+    uint64_t allBlacks = blackPawns | blackRooks | blackKnights | blackBishops | blackQueens | blackKing;
+    uint64_t allPieces = allWhites | allBlacks;
+    int enpassant = nil;
+    int enpassantPiece = nil;
 
-    // ROOK AND BISHOP MAGIC NUMBERS - Numbers to multiply an occupancy bitstring by for optimal hashing
-    // Copied from Chess Programming's BBC Chess Engine
-
-    // rook magic numbers
-    const uint64_t rook_magic_numbers[64] = {
-        0x8a80104000800020ULL,
-        0x140002000100040ULL,
-        0x2801880a0017001ULL,
-        0x100081001000420ULL,
-        0x200020010080420ULL,
-        0x3001c0002010008ULL,
-        0x8480008002000100ULL,
-        0x2080088004402900ULL,
-        0x800098204000ULL,
-        0x2024401000200040ULL,
-        0x100802000801000ULL,
-        0x120800800801000ULL,
-        0x208808088000400ULL,
-        0x2802200800400ULL,
-        0x2200800100020080ULL,
-        0x801000060821100ULL,
-        0x80044006422000ULL,
-        0x100808020004000ULL,
-        0x12108a0010204200ULL,
-        0x140848010000802ULL,
-        0x481828014002800ULL,
-        0x8094004002004100ULL,
-        0x4010040010010802ULL,
-        0x20008806104ULL,
-        0x100400080208000ULL,
-        0x2040002120081000ULL,
-        0x21200680100081ULL,
-        0x20100080080080ULL,
-        0x2000a00200410ULL,
-        0x20080800400ULL,
-        0x80088400100102ULL,
-        0x80004600042881ULL,
-        0x4040008040800020ULL,
-        0x440003000200801ULL,
-        0x4200011004500ULL,
-        0x188020010100100ULL,
-        0x14800401802800ULL,
-        0x2080040080800200ULL,
-        0x124080204001001ULL,
-        0x200046502000484ULL,
-        0x480400080088020ULL,
-        0x1000422010034000ULL,
-        0x30200100110040ULL,
-        0x100021010009ULL,
-        0x2002080100110004ULL,
-        0x202008004008002ULL,
-        0x20020004010100ULL,
-        0x2048440040820001ULL,
-        0x101002200408200ULL,
-        0x40802000401080ULL,
-        0x4008142004410100ULL,
-        0x2060820c0120200ULL,
-        0x1001004080100ULL,
-        0x20c020080040080ULL,
-        0x2935610830022400ULL,
-        0x44440041009200ULL,
-        0x280001040802101ULL,
-        0x2100190040002085ULL,
-        0x80c0084100102001ULL,
-        0x4024081001000421ULL,
-        0x20030a0244872ULL,
-        0x12001008414402ULL,
-        0x2006104900a0804ULL,
-        0x1004081002402ULL
+    uint64_t bitboards[12];
+    // the same position by square: piece on each one, nil if empty. Kept in step with the bitboards
+    uint8_t pieceOn[64];
+
+    int side = white;
+    int castle = 0;
+    // Zobrist key of the position, updated by makeMove/unmakeMove
+    uint64_t hash = 0;
+
+    // Every square the side not to move attacks, found with the mover's king lifted off
+    // the board so it can't step back along a checking ray, and the pieces giving check.
+    // updateAttacks fills them in the first time a position needs them, makeMove drops
+    // them and unmakeMove puts the parent's back
+    uint64_t threats = 0;
+    uint64_t checkers = 0;
+    bool attacksValid = false;
+
+    // castle &= castlingRights[square] for the source and destination of every move:
+    // moving a king or rook, or capturing a rook on its corner, loses the matching rights
+    static constexpr int castlingRights[64] = {
+         7, 15, 15, 15,  3, 15, 15, 11,
+        15, 15, 15, 15, 15, 15, 15, 15,
+        15, 15, 15, 15, 15, 15, 15, 15,
+        15, 15, 15, 15, 15, 15, 15, 15,
+        15, 15, 15, 15, 15, 15, 15, 15,
+        15, 15, 15, 15, 15, 15, 15, 15,
+        15, 15, 15, 15, 15, 15, 15, 15,
+        13, 15, 15, 15, 12, 15, 15, 14
     };
 
-    // bishop magic numbers
-    const uint64_t bishop_magic_numbers[64] = {
-        0x40040844404084ULL,
-        0x2004208a004208ULL,
-        0x10190041080202ULL,
-        0x108060845042010ULL,
-        0x581104180800210ULL,
-        0x2112080446200010ULL,
-        0x1080820820060210ULL,
-        0x3c0808410220200ULL,
-        0x4050404440404ULL,
-        0x21001420088ULL,
-        0x24d0080801082102ULL,
-        0x1020a0a020400ULL,
-        0x40308200402ULL,
-        0x4011002100800ULL,
-        0x401484104104005ULL,
-        0x801010402020200ULL,
-        0x400210c3880100ULL,
-        0x404022024108200ULL,
-        0x810018200204102ULL,
-        0x4002801a02003ULL,
-        0x85040820080400ULL,
-        0x810102c808880400ULL,
-        0xe900410884800ULL,
-        0x8002020480840102ULL,
-        0x220200865090201ULL,
-        0x2010100a02021202ULL,
-        0x152048408022401ULL,
-        0x20080002081110ULL,
-        0x4001001021004000ULL,
-        0x800040400a011002ULL,
-        0xe4004081011002ULL,
-        0x1c004001012080ULL,
-        0x8004200962a00220ULL,
-        0x8422100208500202ULL,
-        0x2000402200300c08ULL,
-        0x8646020080080080ULL,
-        0x80020a0200100808ULL,
-        0x2010004880111000ULL,
-        0x623000a080011400ULL,
-        0x42008c0340209202ULL,
-        0x209188240001000ULL,
-        0x400408a884001800ULL,
-        0x110400a6080400ULL,
-        0x1840060a44020800ULL,
-        0x90080104000041ULL,
-        0x201011000808101ULL,
-        0x1a2208080504f080ULL,
-        0x8012020600211212ULL,
-        0x500861011240000ULL,
-        0x180806108200800ULL,
-        0x4000020e01040044ULL,
-        0x300000261044000aULL,
-        0x802241102020002ULL,
-        0x20906061210001ULL,
-        0x5a84841004010310ULL,
-        0x4010801011c04ULL,
-        0xa010109502200ULL,
-        0x4a02012000ULL,
-        0x500201010098b028ULL,
-        0x8040002811040900ULL,
-        0x28000010020204ULL,
-        0x6000020202d0240ULL,
-        0x8918844842082200ULL,
-        0x4010011029020020ULL
+    // Move representation, 16 bits
+    // 0000 0000 0011 1111  Src Square     0x3f
+    // 0000 1111 1100 0000  Dst Square     0xfc0
+    // 1111 0000 0000 0000  Flags          0xf000
+    //
+    // The moving and captured pieces aren't stored, they're on the board (pieceOn).
+    // In the flags, 0x4 is set for every capture and 0x8 for every promotion, whose
+    // low two bits are the piece: N, B, R, Q
+    enum {
+        quietFlag, doublePushFlag, kingCastleFlag, queenCastleFlag, captureFlag, enpassantFlag,
+        promotionFlag = 8, capturePromotionFlag = 12
     };
 
-    uint64_t blackPawns   = 0x000000000000ff00;
-    uint64_t whitePawns   = 0x00ff000000000000;
-    uint64_t blackKnights = 0x0000000000000042;
-    uint64_t whiteKnights = 0x4200000000000000;
-    uint64_t blackBishops = 0x0000000000000024;
-    uint64_t whiteBishops = 0x2400000000000000;
-    uint64_t blackRooks   = 0x0000000000000081;
-    uint64_t whiteRooks   = 0x8100000000000000;
-    uint64_t blackQueens  = 0x0000000000000008;
-    uint64_t whiteQueens  = 0x0800000000000000;
-    uint64_t blackKing    = 0x0000000000000010;
-    uint64_t whiteKing    = 0x1000000000000000;
-
-    //Precomputed square masks
-    // copied from nkarve/surge 's chess engine
-    const uint64_t SQUARE_BB[65] = {
-        0x1, 0x2, 0x4, 0x8,
-        0x10, 0x20, 0x40, 0x80,
-        0x100, 0x200, 0x400, 0x800,
-        0x1000, 0x2000, 0x4000, 0x8000,
-        0x10000, 0x20000, 0x40000, 0x80000,
-        0x100000, 0x200000, 0x400000, 0x800000,
-        0x1000000, 0x2000000, 0x4000000, 0x8000000,
-        0x10000000, 0x20000000, 0x40000000, 0x80000000,
-        0x100000000, 0x200000000, 0x400000000, 0x800000000,
-        0x1000000000, 0x2000000000, 0x4000000000, 0x8000000000,
-        0x10000000000, 0x20000000000, 0x40000000000, 0x80000000000,
-        0x100000000000, 0x200000000000, 0x400000000000, 0x800000000000,
-        0x1000000000000, 0x2000000000000, 0x4000000000000, 0x8000000000000,
-        0x10000000000000, 0x20000000000000, 0x40000000000000, 0x80000000000000,
-        0x100000000000000, 0x200000000000000, 0x400000000000000, 0x800000000000000,
-        0x1000000000000000, 0x2000000000000000, 0x4000000000000000, 0x8000000000000000,
-        0x0
+    // What makeMove can't work back out from the move itself. The caller keeps one per
+    // move it means to take back, a search one per ply, so the position stays just the board
+    struct UndoRecord {
+        uint64_t hash;
+        int captured;
+        int castle;
+        int enpassant;
+        int enpassantPiece;
+        uint64_t threats;
+        uint64_t checkers;
+        bool attacksValid;
     };
 
-    uint64_t allWhites = whitePawns | whiteRooks | whiteKnights | whiteBishops | whiteQueens | whiteKing;
-    uint64_t allBlacks = blackPawns | blackRooks | blackKnights | blackBishops | blackQueens | blackKing;
-    uint64_t allPieces = allWhites | allBlacks;
-    uint64_t enpassant = nil;
-    int enpassantPiece = nil;
+    template<typename Output>
+    void encodeMove(Output& list, int src, int dst, int flags){
+        if constexpr(Output::countOnly){
+            list.count++;
+        }
+        else {
+            list.add(src | (dst << 6) | (flags << 12));
+        }
+    }
 
-    uint64_t bitboards[12];
-    uint64_t pawnAttacks[2][64];
-    uint64_t knightAttacks[64];
-    uint64_t kingAttacks[64];
-
-    uint64_t bishopMasks[64];
-    uint64_t rookMasks[64];
-    uint64_t bishopAttacks[64][512];
-    uint64_t rookAttacks[64][4096];
-
-    // lookup table to help with generating legal moves
-    uint64_t squaresBetween[64][64];
-
-    uint32_t moveList[256];
-    int moveCount = 0;
-    // Used for detecting checkmate
-    int kingMoveCount = 0;
-
-    int side;
-    int castle;
-
-    // Move representation
-    // 0000 0000 0000 0000 0011 1111  Src Square     0x3f
-    // 0000 0000 0000 1111 1100 0000  Dst Square     0xfc0
-    // 0000 0000 1111 0000 0000 0000  Piece          0xf000
-    // 0000 1111 0000 0000 0000 0000  Promoted piece 0xf0000
-    // 0001 0000 0000 0000 0000 0000  Capture        0x100000
-    // 0010 0000 0000 0000 0000 0000  Double push    0x200000
-    // 0100 0000 0000 0000 0000 0000  Enpassant      0x400000
-    // 1000 0000 0000 0000 0000 0000  Castling       0x800000
-
-    /* HELPER FUNCTIONS FOR STORING AND UNDOING MOVE */
-
-    void copyBitboards(uint64_t (&bitboardsCopy)[12]){
-        std::copy(std::begin(bitboards), std::end(bitboards), std::begin(bitboardsCopy));
+    // pawn moves onto the last rank become one move per promotion piece
+    template<typename Output>
+    void encodePawnMove(Output& list, int src, int dst, int capture, int type){
+        bool promotion = dst <= h8 || dst >= a1;
+        if(type == quietMoves && promotion){
+            return;
+        }
+        if(type == captureMoves && !promotion && !capture){
+            return;
+        }
+        if(promotion){
+            if constexpr(Output::countOnly){
+                list.count += 4;
+                return;
+            }
+            int flags = capture ? capturePromotionFlag : promotionFlag;
+            for(int promotedPiece = Q; promotedPiece >= N; promotedPiece--){
+                encodeMove(list, src, dst, flags + promotedPiece - N);
+            }
+        }
+        else {
+            encodeMove(list, src, dst, capture ? captureFlag : quietFlag);
+        }
+    }
+
+    bool inCheck(){
+        updateAttacks();
+        return checkers != 0;
+    }
+
+    bool isCheckmate(){
+        return countMoves() == 0 && inCheck();
+    }
+    bool isStalemate(){
+        return countMoves() == 0 && !inCheck();
     }
 
-    void copyMoveList(uint32_t (&moveListCopy)[256]){
-        std::copy(std::begin(moveList), std::end(moveList), std::begin(moveListCopy));
+    int getSrc(uint16_t move){
+        return (move & 0x3f);
     }
 
-    int copyMoveCount(){ return moveCount; }
+    int getDst(uint16_t move){
+        return ((move & 0xfc0) >> 6);
+    }
 
-    uint64_t copyAllBlacks(){ return allBlacks; }
-    uint64_t copyAllWhites(){ return allWhites; }
-    int copySide(){ return side; }
-    int copyCastle(){ return castle; }
-    uint64_t copyEnpassant(){ return enpassant; }
-    int copyEnpassantPiece(){ return enpassantPiece; }
+    int getFlags(uint16_t move){
+        return (move >> 12);
+    }
 
-    void undoBitboards(uint64_t (&bitboardsCopy)[12]){
-        std::copy(std::begin(bitboardsCopy), std::end(bitboardsCopy), std::begin(bitboards));
+    // the piece making the move, read off the board, so only valid before it's played
+    int getPiece(uint16_t move){
+        return pieceOn[getSrc(move)];
     }
 
-    void setAllBlacks(uint64_t _allBlacks){ allBlacks = _allBlacks; }
-    void setAllWhites(uint64_t _allWhites){ allWhites = _allWhites; }
-    void setAllPieces(uint64_t _allBlacks, uint64_t _allWhites){ allPieces = _allBlacks | _allWhites; }
-    void setSide(int _side){ side = _side; }
-    void setCastle(int _castle){ castle = _castle; }
-    void setEnpassant(uint64_t _enpassant){ enpassant = _enpassant; }
-    void setEnpassantPiece(int _enpassantPiece){ enpassantPiece = _enpassantPiece; }
-
-    void initSquaresBetween(){
-        uint64_t commonSquares;
-        for (int sq1 = a8; sq1 <= h1; sq1++){
-            for (int sq2 = a8; sq2 <= h1; sq2++) {
-                commonSquares = SQUARE_BB[sq1] | SQUARE_BB[sq2];
-                int sq1Rank = sq1/8;
-                int sq1File = sq1%8;
-                int sq2Rank = sq2/8;
-                int sq2File = sq2%8;
-
-                // on horizontal or vertical
-                if (sq1Rank == sq2Rank || sq1File == sq2File)
-                    squaresBetween[sq1][sq2] = getRookAttacks(sq1, commonSquares) & getRookAttacks(sq2, commonSquares);
-                // on diagonal
-                else if (std::abs(sq1Rank-sq2Rank) == std::abs(sq1File-sq2File))
-                    squaresBetween[sq1][sq2] = getBishopAttacks(sq1, commonSquares) & getBishopAttacks(sq2, commonSquares);
-            }
-        }
+    // piece type promoted to, N..Q without the colour, 0 if none
+    int getPromotedPiece(uint16_t move){
+        return (move & 0x8000) ? ((move >> 12) & 3) + N : 0;
     }
 
-    void encodeMove(int src, int dst, int piece, int promotedPiece, int capture, int allowEnpassant, int castleMove){
-        moveList[moveCount] = (0ULL | (src) | (dst << 6) | (piece << 12) | (promotedPiece << 16) | (capture << 20) | (allowEnpassant << 22) | (castleMove << 23));
-        moveCount++;
+    int getCapture(uint16_t move){
+        return (move & 0x4000);
+    }
+
+    int getDoublePush(uint16_t move){
+        return getFlags(move) == doublePushFlag;
+    }
 
-        if(!side && piece == K){
-            kingMoveCount++;
+    int getEnpassant(uint16_t move){
+        return getFlags(move) == enpassantFlag;
+    }
+
+    int getCastle(uint16_t move){
+        return (move & 0xe000) == (kingCastleFlag << 12);
+    }
+
+    //
+    // Play a move. Only the squares that change are touched: the piece and occupancy
+    // bitboards are XORed with the from/to masks, and what unmakeMove needs to go back
+    // is written to undo.
+    //
+    void makeMove(uint16_t move, UndoRecord& undo){
+        if(!side){
+            makeMoveFor<white>(move, undo);
         }
-        else if(side && piece == k){
-            kingMoveCount++;
+        else {
+            makeMoveFor<black>(move, undo);
         }
     }
 
-    bool isCheckmate(){
-        // king is under attack and has no moves
-        int whiteSquareAttacked = isSquareAttacked(getLsb(bitboards[K]), 1, nil);
-        int blackSquareAttacked = isSquareAttacked(getLsb(bitboards[k]), 0, nil);
+    // a move that won't be taken back, like the game's
+    void makeMove(uint16_t move){
+        UndoRecord undo;
+        makeMove(move, undo);
+    }
 
-        if(whiteSquareAttacked){
-            std::cout << "white square attacked: " << whiteSquareAttacked << std::endl;
-            //printBoard();
-            return moveCount == 0;
+    // Take back the last move made, which has to be move, with the record makeMove filled
+    void unmakeMove(uint16_t move, const UndoRecord& undo){
+        // side is the one to reply, the move was made by the other
+        if(side){
+            unmakeMoveFor<white>(move, undo);
         }
-        else if(blackSquareAttacked){
-            std::cout << "black square attacked: " << blackSquareAttacked << std::endl;
-            //printBoard();
-            return moveCount == 0;
+        else {
+            unmakeMoveFor<black>(move, undo);
         }
-        return false;
     }
-    bool isStalemate(){
-        return moveCount == 0;
+
+    // Pass the move to the other side, for null-move pruning. Nothing on the board
+    // changes, only whose turn it is, and en passant is no longer possible
+    void makeNullMove(UndoRecord& undo){
+        undo.hash = hash;
+        undo.captured = nil;
+        undo.castle = castle;
+        undo.enpassant = enpassant;
+        undo.enpassantPiece = enpassantPiece;
+        undo.threats = threats;
+        undo.checkers = checkers;
+        undo.attacksValid = attacksValid;
+        attacksValid = false;
+
+        if(enpassant != nil){
+            hash ^= zobristKeys.enpassantFile[enpassant % 8];
+        }
+        enpassant = nil;
+        enpassantPiece = nil;
+        side = !side;
+        hash ^= zobristKeys.side;
     }
 
-    int getSrc(uint32_t move){
-        return (move & 0x3f);
+    void unmakeNullMove(const UndoRecord& undo){
+        side = !side;
+        hash = undo.hash;
+        enpassant = undo.enpassant;
+        enpassantPiece = undo.enpassantPiece;
+        threats = undo.threats;
+        checkers = undo.checkers;
+        attacksValid = undo.attacksValid;
     }
 
-    int getDst(uint32_t move){
-        return ((move & 0xfc0) >> 6);
+    template <int Us>
+    void makeMoveFor(uint16_t move, UndoRecord& undo){
+        constexpr int own = Us == white ? P : p;
+        int src = getSrc(move);
+        int dst = getDst(move);
+        int piece = pieceOn[src];
+        // what ends up on dst, the pawn's promotion piece or the piece itself
+        int landing = getPromotedPiece(move) ? getPromotedPiece(move) + own : piece;
+        uint64_t srcMask = 1ULL << src;
+        uint64_t dstMask = 1ULL << dst;
+        // worked on in locals and stored at the end, writes to bitboards could alias them
+        uint64_t ownPieces = Us == white ? allWhites : allBlacks;
+        uint64_t enemyPieces = Us == white ? allBlacks : allWhites;
+
+        undo.hash = hash;
+        undo.captured = nil;
+        undo.castle = castle;
+        undo.enpassant = enpassant;
+        undo.enpassantPiece = enpassantPiece;
+        undo.threats = threats;
+        undo.checkers = checkers;
+        undo.attacksValid = attacksValid;
+        attacksValid = false;
+
+        if(getEnpassant(move)){
+            // the captured pawn sits behind the destination square
+            undo.captured = Us == white ? p : P;
+            bitboards[undo.captured] ^= 1ULL << enpassantPiece;
+            enemyPieces ^= 1ULL << enpassantPiece;
+            hash ^= zobristKeys.pieceSquare[undo.captured][enpassantPiece];
+        }
+        else if(getCapture(move)){
+            undo.captured = pieceOn[dst];
+            bitboards[undo.captured] ^= dstMask;
+            enemyPieces ^= dstMask;
+            hash ^= zobristKeys.pieceSquare[undo.captured][dst];
+        }
+        if(getEnpassant(move)){
+            pieceOn[enpassantPiece] = nil;
+        }
+
+        bitboards[piece] ^= srcMask;
+        bitboards[landing] ^= dstMask;
+        ownPieces ^= srcMask | dstMask;
+        pieceOn[src] = nil;
+        pieceOn[dst] = landing;
+        hash ^= zobristKeys.pieceSquare[piece][src] ^ zobristKeys.pieceSquare[landing][dst];
+
+        if(getCastle(move)){
+            int rookSrc = castleRookSrc(src, dst);
+            int rookDst = (src + dst) / 2;
+            uint64_t rookMask = (1ULL << rookSrc) | (1ULL << rookDst);
+            constexpr int rook = Us == white ? R : r;
+            bitboards[rook] ^= rookMask;
+            ownPieces ^= rookMask;
+            pieceOn[rookSrc] = nil;
+            pieceOn[rookDst] = rook;
+            hash ^= zobristKeys.pieceSquare[rook][rookSrc] ^ zobristKeys.pieceSquare[rook][rookDst];
+        }
+        allWhites = Us == white ? ownPieces : enemyPieces;
+        allBlacks = Us == white ? enemyPieces : ownPieces;
+        allPieces = allWhites | allBlacks;
+
+        // King or rook moves, or a rook is captured at home: castle invalid
+        hash ^= zobristKeys.castle[castle];
+        castle &= castlingRights[src] & castlingRights[dst];
+        hash ^= zobristKeys.castle[castle];
+
+        if(enpassant != nil){
+            hash ^= zobristKeys.enpassantFile[enpassant % 8];
+        }
+        // a double push leaves the square it skipped open for en passant for one move
+        if(getDoublePush(move)){
+            enpassant = (src + dst) / 2;
+            enpassantPiece = dst;
+            hash ^= zobristKeys.enpassantFile[enpassant % 8];
+        }
+        else {
+            enpassant = nil;
+            enpassantPiece = nil;
+        }
+        side = !Us;
+        hash ^= zobristKeys.side;
     }
 
-    int getPiece(uint32_t move){
-        return ((move & 0xf000) >> 12);
+    template <int Us>
+    void unmakeMoveFor(uint16_t move, const UndoRecord& undo){
+        side = Us;
+        hash = undo.hash;
+        castle = undo.castle;
+        enpassant = undo.enpassant;
+        enpassantPiece = undo.enpassantPiece;
+        threats = undo.threats;
+        checkers = undo.checkers;
+        attacksValid = undo.attacksValid;
+
+        constexpr int own = Us == white ? P : p;
+        int src = getSrc(move);
+        int dst = getDst(move);
+        int landing = pieceOn[dst];
+        int piece = getPromotedPiece(move) ? P + own : landing;
+        uint64_t srcMask = 1ULL << src;
+        uint64_t dstMask = 1ULL << dst;
+        uint64_t ownPieces = Us == white ? allWhites : allBlacks;
+        uint64_t enemyPieces = Us == white ? allBlacks : allWhites;
+
+        bitboards[piece] ^= srcMask;
+        bitboards[landing] ^= dstMask;
+        ownPieces ^= srcMask | dstMask;
+        pieceOn[src] = piece;
+        pieceOn[dst] = nil;
+
+        if(undo.captured != nil){
+            int capturedSquare = getEnpassant(move) ? enpassantPiece : dst;
+            bitboards[undo.captured] ^= 1ULL << capturedSquare;
+            enemyPieces ^= 1ULL << capturedSquare;
+            pieceOn[capturedSquare] = undo.captured;
+        }
+        if(getCastle(move)){
+            int rookSrc = castleRookSrc(src, dst);
+            int rookDst = (src + dst) / 2;
+            uint64_t rookMask = (1ULL << rookSrc) | (1ULL << rookDst);
+            constexpr int rook = Us == white ? R : r;
+            bitboards[rook] ^= rookMask;
+            ownPieces ^= rookMask;
+            pieceOn[rookSrc] = rook;
+            pieceOn[rookDst] = nil;
+        }
+        allWhites = Us == white ? ownPieces : enemyPieces;
+        allBlacks = Us == white ? enemyPieces : ownPieces;
+        allPieces = allWhites | allBlacks;
     }
 
-    int getPromotedPiece(uint32_t move){
-        return ((move & 0xf0000) >> 16);
+    // the castling rook starts in the corner past dst and ends on the square the king crossed
+    static int castleRookSrc(int src, int dst){
+        return dst > src ? dst + 1 : dst - 2;
     }
 
-    int getCapture(uint32_t move){
-        return (move & 0x100000);
+    // every piece, of either colour, attacking square with the given occupancy
+    uint64_t attackersTo(int square, uint64_t occupancy){
+        return (attackTables.pawnAttacks[black][square] & bitboards[P])
+             | (attackTables.pawnAttacks[white][square] & bitboards[p])
+             | (attackTables.knightAttacks[square] & (bitboards[N] | bitboards[n]))
+             | (attackTables.kingAttacks[square] & (bitboards[K] | bitboards[k]))
+             | (getBishopAttacks(square, occupancy) & (bitboards[B] | bitboards[b] | bitboards[Q] | bitboards[q]))
+             | (getRookAttacks(square, occupancy) & (bitboards[R] | bitboards[r] | bitboards[Q] | bitboards[q]));
     }
 
-    int getEnpassant(uint32_t move){
-        return (move & 0x400000);
+    // fills in threats and checkers for the side to move, unless they already are
+    void updateAttacks(){
+        if(attacksValid){
+            return;
+        }
+        if(side == white){
+            updateAttacksFor<white>();
+        }
+        else {
+            updateAttacksFor<black>();
+        }
     }
 
-    int getCastle(uint32_t move){
-        return (move & 0x800000);
+    template <int Us>
+    void updateAttacksFor(){
+        constexpr int own = Us == white ? P : p;
+        constexpr int enemy = Us == white ? p : P;
+        int kingSquare = getLsb(bitboards[K + own]);
+        uint64_t occupancy = allPieces ^ (1ULL << kingSquare);
+
+        // pawns all at once, dropping what wraps round onto the far file
+        uint64_t pawns = bitboards[P + enemy];
+        uint64_t attacked = Us == white ? ((pawns << 7) & AttackTables::notHFile) | ((pawns << 9) & AttackTables::notAFile)
+                                        : ((pawns >> 9) & AttackTables::notHFile) | ((pawns >> 7) & AttackTables::notAFile);
+        attacked |= attackTables.kingAttacks[getLsb(bitboards[K + enemy])];
+        uint64_t bitboard = bitboards[N + enemy];
+        while(bitboard){
+            int square = getLsb(bitboard);
+            attacked |= attackTables.knightAttacks[square];
+            pop_bit(bitboard, square);
+        }
+        bitboard = bitboards[B + enemy] | bitboards[Q + enemy];
+        while(bitboard){
+            int square = getLsb(bitboard);
+            attacked |= getBishopAttacks(square, occupancy);
+            pop_bit(bitboard, square);
+        }
+        bitboard = bitboards[R + enemy] | bitboards[Q + enemy];
+        while(bitboard){
+            int square = getLsb(bitboard);
+            attacked |= getRookAttacks(square, occupancy);
+            pop_bit(bitboard, square);
+        }
+
+        threats = attacked;
+        checkers = attacked & bitboards[K + own] ? attackersTo(kingSquare, allPieces) & (Us == white ? allBlacks : allWhites) : 0;
+        attacksValid = true;
     }
 
-    void makeMove(int move){
+    //
+    // Checks a move from somewhere else, a hash or killer move, against the current
+    // position without generating the list. Castling and en passant are left to the
+    // generator, they just come back false.
+    //
+    bool isLegal(uint16_t move){
         int src = getSrc(move);
         int dst = getDst(move);
         int piece = getPiece(move);
-        int promotedPiece = getPromotedPiece(move);
-        int capture = getCapture(move);
-        int allowEnpassant = getEnpassant(move);
-        int castleMove = getCastle(move);
-        pop_bit(bitboards[piece], src);
-
-        // If king moves, make castle invalid
-        if(piece == K && (castle & wk || castle & wq)){
-            castle &= ~wk;
-            castle &= ~wq;
-        }
-        if(piece == k && (castle & bk || castle & bq)){
-            castle &= ~bk;
-            castle &= ~bq;
-        }
-        // If rook moves, make castle invalid
-        // White queenside rook
-        if(src == a1 && (castle & wq)){
-            castle &= ~wq;
-        }
-        // White kingside rook
-        else if(src == h1 && (castle & wk)){
-            castle &= ~wk;
-        }
-        // Black queenside rook
-        else if(src == a8 && (castle & bq)){
-            castle &= ~bq;
-        }
-        // Black kingside rook
-        else if(src == h8 && (castle & bk)){
-            castle &= ~bk;
-        }
-
-        if(castleMove){
-            // White kingside
-            if(dst == g1){
-                pop_bit(bitboards[K], src);
-                set_bit(bitboards[K], g1);
-                pop_bit(bitboards[R], h1);
-                set_bit(bitboards[R], f1);
-            }
-            // White queenside
-            else if(dst == c1){
-                pop_bit(bitboards[K], src);
-                set_bit(bitboards[K], c1);
-                pop_bit(bitboards[R], a1);
-                set_bit(bitboards[R], d1);
-            }
-            // Black kingside
-            else if(dst == g8){
-                pop_bit(bitboards[k], src);
-                set_bit(bitboards[k], g8);
-                pop_bit(bitboards[r], h8);
-                set_bit(bitboards[r], f8);
-            }
-            // Black queenside
-            else if(dst == c8){
-                pop_bit(bitboards[k], src);
-                set_bit(bitboards[k], c8);
-                pop_bit(bitboards[r], a8);
-                set_bit(bitboards[r], d8);
-            }
+        int own = !side ? P : p;
+        uint64_t ownPieces = !side ? allWhites : allBlacks;
+        uint64_t enemyPieces = !side ? allBlacks : allWhites;
+
+        if(!move || getCastle(move) || getEnpassant(move)){
+            return false;
+        }
+        // flags 6 and 7 are never generated, but getCapture would take them for captures
+        if(getFlags(move) == 6 || getFlags(move) == 7){
+            return false;
+        }
+        if(piece < own || piece > K + own || !get_bit(bitboards[piece], src) || get_bit(ownPieces, dst)){
+            return false;
+        }
+        if(!getCapture(move) != !get_bit(enemyPieces, dst) || get_bit(bitboards[K + (!side ? p : P)], dst)){
+            return false;
         }
-        else {
-            if(promotedPiece){
-                set_bit(bitboards[promotedPiece], dst);
-            }
-            else {
-                set_bit(bitboards[piece], dst);
-            }
 
-            if(enpassant && capture && enpassant == dst){
-                pop_bit((!side ? bitboards[p] : bitboards[P]), enpassantPiece);
-            }
-            else if(capture){
-                // Delete captured piece
-                int startPiece = !side ? p : P;
-                int endPiece = !side ? k : K;
-
-                for(int i = startPiece; i <= endPiece; i++){
-                    if(get_bit(bitboards[i], dst)){
-                        pop_bit(bitboards[i], dst);
+        uint64_t reach = 0;
+        switch(piece - own){
+            case P: {
+                int forward = !side ? -8 : 8;
+                bool promotion = dst <= h8 || dst >= a1;
+                if(!getPromotedPiece(move) != !promotion){
+                    return false;
+                }
+                if(getCapture(move)){
+                    reach = attackTables.pawnAttacks[side][src];
+                }
+                else if(getDoublePush(move)){
+                    bool startRank = !side ? (src >= a2 && src <= h2) : (src >= a7 && src <= h7);
+                    if(startRank && !get_bit(allPieces, src + forward)){
+                        reach = 1ULL << (src + 2 * forward);
                     }
                 }
+                else {
+                    reach = 1ULL << (src + forward);
+                }
+                break;
             }
+            case N: reach = attackTables.knightAttacks[src]; break;
+            case B: reach = getBishopAttacks(src, allPieces); break;
+            case R: reach = getRookAttacks(src, allPieces); break;
+            case Q: reach = getQueenAttacks(src, allPieces); break;
+            case K: reach = attackTables.kingAttacks[src]; break;
         }
-        allWhites = 0;
-        allBlacks = 0;
-        for(int i = P; i <= K; i++){
-            allWhites |= bitboards[i];
-        }
-        for(int i = p; i <= k; i++){
-            allBlacks |= bitboards[i];
+        if(!get_bit(reach, dst) || (getPromotedPiece(move) && piece != own) || (getDoublePush(move) && piece != own)){
+            return false;
         }
 
-        //std::cout << "Make move: allWhites: " << std::endl;
-        //printBitboard(allWhites);
-        //std::cout << "Make move: allBlacks: " << std::endl;
-        //printBitboard(allBlacks);
-
-        allPieces = 0;
-        allPieces |= allBlacks;
-        allPieces |= allWhites;
+        // play it on the occupancy and see whether anything still reaches our king
+        uint64_t occupancy = (allPieces ^ (1ULL << src)) | (1ULL << dst);
+        int kingSquare = piece == K + own ? dst : getLsb(bitboards[K + own]);
+        return !(attackersTo(kingSquare, occupancy) & enemyPieces & ~(1ULL << dst));
+    }
 
-        side = !side;
-        if(!allowEnpassant){
-            enpassant = nil;
-            enpassantPiece = nil;
-        }
+    // piece values for the static exchange, in centipawns by piece type P..K.
+    // The king is worth more than anything it could win
+    static constexpr int seeValues[6] = { 100, 320, 330, 500, 900, 20000 };
+
+    //
+    // Static exchange evaluation: the material move wins once both sides have taken
+    // back on its destination square as long as it pays, cheapest piece first. Each
+    // capture lifts its piece off the occupancy, so sliders lined up behind it join in
+    // as x-rays. Pins are ignored. Quiet moves score what the opponent can win back.
+    //
+    int see(uint16_t move){
+        int dst = getDst(move);
+        uint64_t occupancy;
+        uint64_t attackers = exchangeAttackers(move, occupancy);
+        int gain[32];
+        gain[0] = captureGain(move);
+        int value = pieceValueOnDst(move);
+        int depth = 0;
+        for(int attackingSide = !side; ; attackingSide = !attackingSide){
+            int square;
+            int piece = leastValuableAttacker(attackers, attackingSide, square);
+            // a king can't take into a square the other side still covers
+            if(piece == nil || (piece == K && (attackers & (attackingSide == white ? allBlacks : allWhites)))){
+                break;
+            }
+            depth++;
+            // what this side is up if it takes and the exchange ends there
+            gain[depth] = value - gain[depth - 1];
+            attackers = removeAttacker(attackers, occupancy, dst, square, piece);
+            value = seeValues[piece];
+        }
+        // back up the sequence, each side may stop instead of taking
+        while(depth > 0){
+            gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+            depth--;
+        }
+        return gain[0];
     }
 
-    // encoding:
-    // 0000 000000        0000 000000
-    // second checker     first checker
-    // piece  location    piece location
-
-    // previous piece is needed for king evasion. makes sure it doesn't block checks.
-    int isSquareAttacked(int square, int attackingSide, int previousSquare){
-        int count = 0;
-        int checkers = 0;
-        int checkingSquare = 0;
-        // Attacked by white side
-        if(!attackingSide){
-            // Attacked by white pawns
-            uint64_t pawnAttacked = pawnAttacks[black][square] & bitboards[P];
-            if(pawnAttacked){
-                checkers |= (getLsb(pawnAttacked) << (count * 10));
-                checkers |= ((P + 1) << (6 + count * 10));
-                count++;
+    // see(move) >= threshold, but stops as soon as the answer is known
+    bool seeGreaterEqual(uint16_t move, int threshold){
+        int dst = getDst(move);
+        // our margin over threshold if nothing takes back
+        int swap = captureGain(move) - threshold;
+        if(swap < 0){
+            return false;
+        }
+        // from here swap is the margin of the side that just took, if that's the end of it
+        swap = pieceValueOnDst(move) - swap;
+        if(swap <= 0){
+            return true;
+        }
+        uint64_t occupancy;
+        uint64_t attackers = exchangeAttackers(move, occupancy);
+        // the answer if the exchange ends now, flipped with every capture
+        bool result = true;
+        for(int attackingSide = !side; ; attackingSide = !attackingSide){
+            int square;
+            int piece = leastValuableAttacker(attackers, attackingSide, square);
+            if(piece == nil){
+                break;
             }
-        }
-        // Black side
-        else {
-            uint64_t pawnAttacked = pawnAttacks[white][square] & bitboards[p];
-            if(pawnAttacked){
-                checkers |= (getLsb(pawnAttacked) << (count * 10));
-                checkers |= ((p + 1) << (6 + count * 10));
-                count++;
+            result = !result;
+            if(piece == K){
+                return (attackers & (attackingSide == white ? allBlacks : allWhites)) ? !result : result;
             }
+            swap = seeValues[piece] - swap;
+            if(swap < (int)result){
+                break;
+            }
+            attackers = removeAttacker(attackers, occupancy, dst, square, piece);
         }
+        return result;
+    }
 
-        uint64_t allPiecesMask = allPieces;
-        if(previousSquare != nil){
-            allPiecesMask ^= (1ULL << previousSquare);
-        }
-
-        uint64_t knightAttacked = knightAttacks[square] & (!attackingSide ? bitboards[N] : bitboards[n]);
-        if(knightAttacked){
-            checkers |= (getLsb(knightAttacked) << (count * 10));
-            checkers |= (((!attackingSide ? N : n) + 1) << (6 + count * 10));
-            count++;
+    // material the move itself takes, a promotion counts as the pawn turning into the new piece
+    int captureGain(uint16_t move){
+        int gain = 0;
+        if(getEnpassant(move)){
+            gain = seeValues[P];
         }
-        uint64_t bishopAttacked = getBishopAttacks(square, allPiecesMask) & (!attackingSide ? bitboards[B] : bitboards[b]);
-        std::cout << "all pieces" << std::endl;
-        printBitboard(getBishopAttacks(square, allPieces));
-        std::cout << "all piecesmask" << std::endl;
-        printBitboard(getBishopAttacks(square, allPiecesMask));
-        std::cout << "attacking bishop" << std::endl;
-        printBitboard(!attackingSide ? bitboards[B] : bitboards[b]);
-        if(bishopAttacked){
-            checkers |= (getLsb(bishopAttacked) << (count * 10));
-            checkers |= (((!attackingSide ? B : b) + 1) << (6 + count * 10));
-            count++;
+        else if(getCapture(move)){
+            gain = seeValues[pieceOn[getDst(move)] % 6];
         }
-        uint64_t rookAttacked = getRookAttacks(square, allPiecesMask) & (!attackingSide ? bitboards[R] : bitboards[r]);
-        if(rookAttacked){
-            checkers |= (getLsb(rookAttacked) << (count * 10));
-            checkers |= (((!attackingSide ? R : r) + 1) << (6 + count * 10));
-            count++;
+        if(getPromotedPiece(move)){
+            gain += seeValues[getPromotedPiece(move) % 6] - seeValues[P];
         }
+        return gain;
+    }
 
-        uint64_t queenAttacked = getQueenAttacks(square, allPiecesMask) & (!attackingSide ? bitboards[Q] : bitboards[q]);
-        if(queenAttacked){
-            checkers |= (getLsb(queenAttacked) << (count * 10));
-            checkers |= (((!attackingSide ? Q : q) + 1) << (6 + count * 10));
-            count++;
-        }
+    // what the opponent wins by taking the piece that just moved
+    int pieceValueOnDst(uint16_t move){
+        return seeValues[(getPromotedPiece(move) ? getPromotedPiece(move) : getPiece(move)) % 6];
+    }
 
-        uint64_t kingAttacked = kingAttacks[square] & (!attackingSide ? bitboards[K] : bitboards[k]);
-        if(kingAttacked){
-            checkers |= (getLsb(kingAttacked) << (count * 10));
-            checkers |= (((!attackingSide ? K : k) + 1) << (6 + count * 10));
-            count++;
+    // both sides' pieces bearing on the move's destination once it has been played,
+    // and the occupancy that goes with them
+    uint64_t exchangeAttackers(uint16_t move, uint64_t& occupancy){
+        occupancy = allPieces ^ (1ULL << getSrc(move));
+        if(getEnpassant(move)){
+            occupancy ^= 1ULL << enpassantPiece;
         }
-        return checkers;
+        return attackersTo(getDst(move), occupancy) & occupancy;
     }
 
-    int getCheckerLocation(int checkers){
-        return (checkers & 0x3f);
+    // cheapest of attackingSide's pieces in attackers as a type P..K, nil if none
+    int leastValuableAttacker(uint64_t attackers, int attackingSide, int& square){
+        int offset = attackingSide == white ? P : p;
+        for(int piece = P; piece <= K; piece++){
+            uint64_t bitboard = attackers & bitboards[piece + offset];
+            if(bitboard){
+                square = getLsb(bitboard);
+                return piece;
+            }
+        }
+        return nil;
     }
-    int getCheckerPiece(int checkers){
-        return ((checkers & 0x3c0) >> 6) - 1;
+
+    // the piece on square has captured on dst, take it out and add any slider it was screening
+    uint64_t removeAttacker(uint64_t attackers, uint64_t& occupancy, int dst, int square, int piece){
+        occupancy ^= 1ULL << square;
+        if(piece == P || piece == B || piece == Q){
+            attackers |= getBishopAttacks(dst, occupancy) & (bitboards[B] | bitboards[b] | bitboards[Q] | bitboards[q]);
+        }
+        if(piece == R || piece == Q){
+            attackers |= getRookAttacks(dst, occupancy) & (bitboards[R] | bitboards[r] | bitboards[Q] | bitboards[q]);
+        }
+        return attackers & occupancy;
     }
 
     // convert ASCII character pieces to encoded constants
@@ -738,11 +815,15 @@ public:
 
             // init enpassant square
             enpassant = rank * 8 + file;
+            // the pawn that can be taken is one rank past it
+            enpassantPiece = side == white ? enpassant + 8 : enpassant - 8;
         }
 
         // no enpassant square
-        else
+        else {
             enpassant = nil;
+            enpassantPiece = nil;
+        }
 
         // loop over white pieces bitboards
         for (int piece = P; piece <= K; piece++)
@@ -757,6 +838,10 @@ public:
         // init all occupancies
         allPieces |= allWhites;
         allPieces |= allBlacks;
+
+        setPieceOn();
+        hash = computeHash();
+        attacksValid = false;
     }
 
 
@@ -773,288 +858,80 @@ public:
         bitboards[9] = blackRooks;
         bitboards[10] = blackQueens;
         bitboards[11] = blackKing;
+        setPieceOn();
+        hash = computeHash();
+        attacksValid = false;
     }
 
-    std::string squareToCoords(int square){
-        std::string coords = "";
-        coords += ('a' + (square % 8));
-        coords += ('8' - (square / 8));
-        return coords;
-    }
-
-    int countBits(uint64_t bitboard){
-        int count = 0;
-        while(bitboard){
-            count++;
-            bitboard &= bitboard - 1;
+    // the Zobrist key worked out from scratch, makeMove keeps hash equal to this
+    uint64_t computeHash(){
+        uint64_t key = 0;
+        for(int square = 0; square < 64; square++){
+            if(pieceOn[square] != nil){
+                key ^= zobristKeys.pieceSquare[pieceOn[square]][square];
+            }
         }
-        return count;
-    }
-
-    int getLsb(uint64_t bitboard){
-        if(bitboard){
-            return countBits((bitboard & -bitboard) - 1);
+        key ^= zobristKeys.castle[castle];
+        if(enpassant != nil){
+            key ^= zobristKeys.enpassantFile[enpassant % 8];
         }
-        printBoard();
-        return -1;
-    }
-
-    uint64_t generatePawnAttack(int square, int side){
-        uint64_t attacks = 0;
-        uint64_t bitboard = 0;
-
-        set_bit(bitboard, square);
-
-        //white pawns
-        if(!side){
-            attacks |= ((bitboard >> 7) & notAFile);
-            attacks |= ((bitboard >> 9) & notHFile);
+        if(side){
+            key ^= zobristKeys.side;
         }
-        //black pawns
-        else {
-            attacks |= ((bitboard << 7) & notHFile);
-            attacks |= ((bitboard << 9) & notAFile);
-        }
-
-        return attacks;
-    }
-
-    uint64_t generateKnightAttack(int square){
-        uint64_t attacks = 0;
-        uint64_t bitboard = 0;
-
-        set_bit(bitboard, square);
-
-        attacks |= ((bitboard >> 15) & notAFile);
-        attacks |= ((bitboard >> 17) & notHFile);
-
-        attacks |= ((bitboard >> 10) & notHGFile);
-        attacks |= ((bitboard >> 6) & notABFile);
-
-        attacks |= ((bitboard << 15) & notHFile);
-        attacks |= ((bitboard << 17) & notAFile);
-
-        attacks |= ((bitboard << 10) & notABFile);
-        attacks |= ((bitboard << 6) & notHGFile);
-
-        return attacks;
-    }
-
-    uint64_t generateKingAttack(int square){
-        uint64_t attacks = 0;
-        uint64_t bitboard = 0;
-
-        set_bit(bitboard, square);
-
-        // Up right diagonal
-        attacks |= ((bitboard >> 7) & notAFile);
-        // Up
-        attacks |= (bitboard >> 8);
-        // Up left diagonal
-        attacks |= ((bitboard >> 9) & notHFile);
-
-        // Down left diagonal
-        attacks |= ((bitboard << 7) & notHFile);
-        // Down
-        attacks |= (bitboard << 8);
-        // Down right diagonal
-        attacks |= ((bitboard << 9) & notAFile);
-
-        // Left
-        attacks |= ((bitboard >> 1) & notHFile);
-        // Right
-        attacks |= ((bitboard << 1) & notAFile);
-
-        return attacks;
-    }
-
-    uint64_t generateBishopAttack(int square){
-        uint64_t attacks = 0;
-        int r = square / 8;
-        int c = square % 8;
-        int i, j;
-
-        for(i = r + 1, j = c + 1; i <= 6 && j <= 6; i++, j++) attacks |= (1ULL << (i * 8 + j));
-        for(i = r + 1, j = c - 1; i <= 6 && j >= 1; i++, j--) attacks |= (1ULL << (i * 8 + j));
-        for(i = r - 1, j = c + 1; i >= 1 && j <= 6; i--, j++) attacks |= (1ULL << (i * 8 + j));
-        for(i = r - 1, j = c - 1; i >= 1 && j >= 1; i--, j--) attacks |= (1ULL << (i * 8 + j));
-
-        return attacks;
+        return key;
     }
 
-    uint64_t generateRookAttack(int square){
-        uint64_t attacks = 0;
-        int r = square / 8;
-        int c = square % 8;
-        int i, j;
-
-        for(i = r + 1; i <= 6; i++) attacks |= (1ULL << (i * 8 + c));
-        for(i = r - 1; i >= 1; i--) attacks |= (1ULL << (i * 8 + c));
-        for(j = c + 1; j <= 6; j++) attacks |= (1ULL << (r * 8 + j));
-        for(j = c - 1; j >= 1; j--) attacks |= (1ULL << (r * 8 + j));
-
-        return attacks;
-    }
-
-    uint64_t generateBlockedBishopAttack(int square, uint64_t blockers){
-        uint64_t attacks = 0;
-        uint64_t attack = 0;
-        int r = square / 8;
-        int c = square % 8;
-        int i, j;
-
-        for(i = r + 1, j = c + 1; i <= 7 && j <= 7; i++, j++){
-            attack = (1ULL << (i * 8 + j));
-            attacks |= attack;
-            if(attack & blockers) break;
-        }
-        for(i = r + 1, j = c - 1; i <= 7 && j >= 0; i++, j--){
-            attack = (1ULL << (i * 8 + j));
-            attacks |= attack;
-            if(attack & blockers) break;
-        }
-        for(i = r - 1, j = c + 1; i >= 0 && j <= 7; i--, j++){
-            attack = (1ULL << (i * 8 + j));
-            attacks |= attack;
-            if(attack & blockers) break;
-        }
-        for(i = r - 1, j = c - 1; i >= 0 && j >= 0; i--, j--){
-            attack = (1ULL << (i * 8 + j));
-            attacks |= attack;
-            if(attack & blockers) break;
-        }
-        return attacks;
-    }
-
-    uint64_t generateBlockedRookAttack(int square, uint64_t blockers){
-        uint64_t attacks = 0;
-        uint64_t attack = 0;
-        int r = square / 8;
-        int c = square % 8;
-        int i, j;
-
-        for(i = r + 1; i <= 7; i++){
-            attack = (1ULL << (i * 8 + c));
-            attacks |= attack;
-            if(attack & blockers) break;
-        }
-        for(i = r - 1; i >= 0; i--){
-            attack = (1ULL << (i * 8 + c));
-            attacks |= attack;
-            if(attack & blockers) break;
-        }
-        for(j = c + 1; j <= 7; j++){
-            attack = (1ULL << (r * 8 + j));
-            attacks |= attack;
-            if(attack & blockers) break;
-        }
-        for(j = c - 1; j >= 0; j--){
-            attack = (1ULL << (r * 8 + j));
-            attacks |= attack;
-            if(attack & blockers) break;
+    // rebuild the mailbox from the bitboards
+    void setPieceOn(){
+        memset(pieceOn, nil, sizeof(pieceOn));
+        for(int piece = P; piece <= k; piece++){
+            uint64_t bitboard = bitboards[piece];
+            while(bitboard){
+                int square = getLsb(bitboard);
+                pieceOn[square] = piece;
+                pop_bit(bitboard, square);
+            }
         }
-
-        return attacks;
     }
 
-    // Set Occupancies: Copied from Chess Programming's BBC Chess Engine
-    uint64_t getPossibleOccupancies(int index, int bitsInMask, uint64_t attackMask){
-        uint64_t occupancy = 0;
-
-        for(int count = 0; count < bitsInMask; count++){
-            int square = getLsb(attackMask);
-            pop_bit(attackMask, square);
-
-            if(index & (1 << count))
-                occupancy |= (1ULL << square);
-        }
-
-        return occupancy;
+    std::string squareToCoords(int square){
+        std::string coords = "";
+        coords += ('a' + (square % 8));
+        coords += ('8' - (square / 8));
+        return coords;
     }
 
-
-
-    void initPawnAttacks(){
-        for(int i = 0; i < 64; i++){
-            pawnAttacks[0][i] = generatePawnAttack(i, 0);
-            pawnAttacks[1][i] = generatePawnAttack(i, 1);
-        }
-    }
-    void initKnightAttacks(){
-        for(int i = 0; i < 64; i++){
-            knightAttacks[i] = generateKnightAttack(i);
-        }
-    }
-    void initKingAttacks(){
-        for(int i = 0; i < 64; i++){
-            kingAttacks[i] = generateKingAttack(i);
+    // long algebraic notation as UCI uses it: e2e4, e7e8q
+    std::string moveToString(uint16_t move){
+        std::string text = squareToCoords(getSrc(move)) + squareToCoords(getDst(move));
+        if(getPromotedPiece(move)){
+            text += ascii_pieces[getPromotedPiece(move) + p];
         }
+        return text;
     }
 
-    void initSliderAttacks(int bishop){
-        for(int square = 0; square < 64; square++){
-
-            // All possible attacks (Except edge)
-            bishopMasks[square] = generateBishopAttack(square);
-            rookMasks[square] = generateRookAttack(square);
-
-            // All possible attacks of the given square (except edge)
-            uint64_t attackMask = bishop ? bishopMasks[square] : rookMasks[square];
-
-            // Number of bits needed to store the attack board
-            int relevantBitsCount = countBits(attackMask);
-            //
-            int occupancyIndices = (1 << relevantBitsCount);
-
-            for(int i = 0; i < occupancyIndices; i++){
-                if(bishop){
-                    uint64_t occupancy = getPossibleOccupancies(i, relevantBitsCount, attackMask);
-                    int magicIndex = (occupancy * bishop_magic_numbers[square]) >> (64 - bishop_relevant_bits[square]);
-                    bishopAttacks[square][magicIndex] = generateBlockedBishopAttack(square, occupancy);
-                }
-                else {
-                    uint64_t occupancy = getPossibleOccupancies(i, relevantBitsCount, attackMask);
-                    int magicIndex = (occupancy * rook_magic_numbers[square]) >> (64 - rook_relevant_bits[square]);
-                    rookAttacks[square][magicIndex] = generateBlockedRookAttack(square, occupancy);
-                }
-            }
+    int countBits(uint64_t bitboard){
+        return AttackTables::countBits(bitboard);
+    }
 
+    int getLsb(uint64_t bitboard){
+        if(bitboard){
+            return AttackTables::getLsb(bitboard);
         }
+        printBoard();
+        return -1;
     }
 
     uint64_t getBishopAttacks(int square, uint64_t occupancy){
-        occupancy &= bishopMasks[square];
-        occupancy *= bishop_magic_numbers[square];
-        occupancy >>= 64 - bishop_relevant_bits[square];
-
-        return bishopAttacks[square][occupancy];
+        return attackTables.getBishopAttacks(square, occupancy);
     }
 
     uint64_t getRookAttacks(int square, uint64_t occupancy){
-        occupancy &= rookMasks[square];
-        occupancy *= rook_magic_numbers[square];
-        occupancy >>= 64 - rook_relevant_bits[square];
-
-        return rookAttacks[square][occupancy];
+        return attackTables.getRookAttacks(square, occupancy);
     }
 
     uint64_t getQueenAttacks(int square, uint64_t occupancy){
-
-        uint64_t queenAttacks = 0;
-        uint64_t bishopOccupancy = occupancy;
-        uint64_t rookOccupancy = occupancy;
-
-        bishopOccupancy &= bishopMasks[square];
-        bishopOccupancy *= bishop_magic_numbers[square];
-        bishopOccupancy >>= 64 - bishop_relevant_bits[square];
-
-        rookOccupancy &= rookMasks[square];
-        rookOccupancy *= rook_magic_numbers[square];
-        rookOccupancy >>= 64 - rook_relevant_bits[square];
-
-        queenAttacks = bishopAttacks[square][bishopOccupancy];
-        queenAttacks |= rookAttacks[square][rookOccupancy];
-        return queenAttacks;
+        return attackTables.getQueenAttacks(square, occupancy);
     }
 
     void printBitboard(uint64_t bitboard){
@@ -1077,13 +954,9 @@ public:
                 int square = rank * 8 + file;
                 if(!file)
                     std::cout << "  " << 8 - rank << "  ";
-                int piece = -1;
-                for(int i = P; i <= k; i++){
-                    if(get_bit(bitboards[i], square))
-                        piece = i;
-                }
+                int piece = pieceOn[square];
 
-                std::cout << " " << ((piece == -1) ? '.' : ascii_pieces[piece]);
+                std::cout << " " << ((piece == nil) ? '.' : ascii_pieces[piece]);
             }
             std::cout << std::endl;
         }
@@ -1094,593 +967,205 @@ public:
         std::cout << std::endl;
     }
 
-    // generate only legal moves, when king is in check
-    void generateLegalMoves(){
-        // if king is attacked by two pieces, only encode king evasion moves.
-        // 15 = 1111,  checkers are encoded like 0000 0000 second checker first checker
-        uint64_t bitboard, attacks;
-        moveCount = 0;
-        kingMoveCount = 0;
-
-        int checkers = !side ? isSquareAttacked(getLsb(bitboards[K]), 1, nil) : isSquareAttacked(getLsb(bitboards[k]), 0, nil);
-
-        // King
-        bitboard = !side ? bitboards[K] : bitboards[k];
-        while(bitboard){
-            int src = getLsb(bitboard);
-            attacks = kingAttacks[src] & (!side ? ~allWhites : ~allBlacks);
-
-            while(attacks){
-                int target = getLsb(attacks);
-
-                // Quiet move
-                if(!isSquareAttacked(target, !side, src) && (!get_bit((!side ? allBlacks : allWhites), target))){
-                    std::cout << "King quiet move " << squareToCoords(src) << " -> " << squareToCoords(target) << std::endl;
-                    encodeMove(src, target, (!side ? K : k), 0, 0, 0, 0);
-                }
-                // Capture Move
-                else if(!isSquareAttacked(target, !side, src)){
-                    std::cout << "King capture move " << squareToCoords(src) << " -> " << squareToCoords(target) << std::endl;
-                    encodeMove(src, target, (!side ? K : k), 0, 1, 0, 0);
-                }
-
-                pop_bit(attacks, target);
-            }
-            pop_bit(bitboard, src);
+    //
+    // Generate every legal move for the side to move, or only its captures or quiets, into list.
+    // Checkers, pinned pieces and the check-block mask are worked out once up front,
+    // so nothing in the list can leave the king in check and callers never have to
+    // test the moves again.
+    //
+    template<typename Output>
+    void generateMoves(Output& list, int type = allMoves){
+        if(side == white){
+            generateMovesFor<white>(list, type);
         }
-
-        // two checkers, only generate king moves
-        if(checkers >= 1024){
-            return;
+        else {
+            generateMovesFor<black>(list, type);
         }
+    }
 
-        // only one checker, subtract one , isSquareattacked returns 1-index pieces to avoid 0
-        int checkingPiece = getCheckerPiece(checkers);
-        int checkingPieceSquare = getCheckerLocation(checkers);
-        uint64_t blockingMask = squaresBetween[!side ? getLsb(bitboards[K]) : getLsb(bitboards[k])][checkingPieceSquare];
-
-        std::cout<<"common squares: "<<std::endl;
-        printBitboard(SQUARE_BB[!side ? getLsb(bitboards[K]) : getLsb(bitboards[k])] | SQUARE_BB[checkingPieceSquare]);
+    // generateMoves for one side, picked at compile time so nothing in here tests the colour
+    template<int Us, typename Output>
+    void generateMovesFor(Output& list, int type){
+        uint64_t bitboard, attacks;
+        list.count = 0;
 
-        std::cout<<"blocking mask: "<<std::endl;
-        printBitboard(blockingMask);
+        // our pieces are bitboards[piece + own], theirs bitboards[piece + enemy]
+        constexpr int own = Us == white ? P : p;
+        constexpr int enemy = Us == white ? p : P;
+        uint64_t ownPieces = Us == white ? allWhites : allBlacks;
+        uint64_t enemyPieces = Us == white ? allBlacks : allWhites;
+        int kingSquare = getLsb(bitboards[K + own]);
 
-        // knight, pawn, queen, rook, bishop -> captures, and quiet moves that coincide with blocking mask
+        // squares piece moves may land on for this type of generation
+        uint64_t targets = type == captureMoves ? enemyPieces : type == quietMoves ? ~allPieces : ~ownPieces;
 
-        // IF CHECKER IS KNIGHT OR PAWN - only generate captures.
-        bool onlyGenerateCaptures = checkingPiece == N || checkingPiece == n || checkingPiece == P || checkingPiece == p;
+        updateAttacks();
 
-        // White pawn quiet moves and captures
-        if(side == white){
-            // captures
-            attacks = pawnAttacks[black][checkingPieceSquare] & bitboards[P];
+        // King, never onto an attacked square
+        encodeTargets(list, kingSquare, attackTables.kingAttacks[kingSquare] & targets & ~threats, enemyPieces);
 
-            while(attacks){
-                int src = getLsb(attacks);
-                if(checkingPieceSquare < a7){
-                    std::cout << "CheckEvasion: Pawn promotion capture " << squareToCoords(src) << " -> " << squareToCoords(checkingPieceSquare) << std::endl;
-                    encodeMove(src, checkingPieceSquare, P, Q, 1, 0, 0);
-                }
-                // enpassant is also handle in this case automatically by makemove
-                else {
-                    std::cout << "CheckEvasion: Pawn capture " << squareToCoords(src) << " -> " << squareToCoords(checkingPieceSquare) << std::endl;
-                    encodeMove(src, checkingPieceSquare, P, 0, 1, 0, 0);
-                }
-                pop_bit(attacks, src);
-            }
-            // quiet moves
-            if(!onlyGenerateCaptures){
-                bitboard = bitboards[P];
-                while(bitboard){
-                    int src = getLsb(bitboard);
-                    // Forward push
-                    int dst = src - 8;
-
-                    // if single forward push will block a check
-                    if(blockingMask & (1ULL << dst)){
-                        if(dst >= a8 && !get_bit(allPieces, dst)){
-                            // Check for promotion
-                            if(dst < a7){
-                                std::cout << "CheckEvasion: Pawn promotion " << squareToCoords(src) << " -> " << squareToCoords(dst) << std::endl;
-                                encodeMove(src, dst, P, Q, 0, 0, 0);
-                            }
-                            else {
-                                std::cout << "CheckEvasion: Pawn quiet move " << squareToCoords(src) << " -> " << squareToCoords(dst) << std::endl;
-                                encodeMove(src, dst, P, 0, 0, 0, 0);
-                            }
-                        }
-                    }
-                    int doubleDst = dst - 8;
-                    // if double push will block a check
-                    if(blockingMask & (1ULL << doubleDst)){
-                        if(src >= a2 && src <= h2 && (!get_bit(allPieces, doubleDst))){
-                            if(pawnAttacks[white][dst] & bitboards[p]){
-                                std::cout << "CheckEvasion: Move up twice (enemy can enpassant)" << squareToCoords(src) << " -> " << squareToCoords(doubleDst) << std::endl;
-                                enpassant = dst;
-                                enpassantPiece = doubleDst;
-                                encodeMove(src, doubleDst, P, 0, 0, 1, 0);
-                            }
-                            else {
-                                std::cout << "CheckEvasion: Move up twice " << squareToCoords(src) << " -> " << squareToCoords(doubleDst) << std::endl;
-                                encodeMove(src, doubleDst, P, 0, 0, 0, 0);
-                            }
-                        }
-                    }
-                    pop_bit(bitboard, src);
-                }
-            }
-        }
-        else if(side == black){
-            attacks = pawnAttacks[white][checkingPieceSquare] & bitboards[p];
-
-            while(attacks){
-                int src = getLsb(attacks);
-                if(checkingPieceSquare >= a1){
-                    std::cout << "CheckEvasion: Pawn promotion capture " << squareToCoords(src) << " -> " << squareToCoords(checkingPieceSquare) << std::endl;
-                    encodeMove(src, checkingPieceSquare, p, q, 1, 0, 0);
-                }
-                else {
-                    std::cout << "CheckEvasion: Pawn capture " << squareToCoords(src) << " -> " << squareToCoords(checkingPieceSquare) << std::endl;
-                    encodeMove(src, checkingPieceSquare, p, 0, 1, 0, 0);
-                }
-                pop_bit(attacks, src);
-            }
-            // quiet moves
-            if(!onlyGenerateCaptures){
-                bitboard = bitboards[p];
-                while(bitboard){
-                    int src = getLsb(bitboard);
-                    // Forward push
-                    int dst = src + 8;
-
-                    // if single forward push will block a check
-                    if(blockingMask & (1ULL << dst)){
-                        if(dst <= h1 && !get_bit(allPieces, dst)){
-                            // Check for promotion
-                            if(dst >= a1){
-                                std::cout << "CheckEvasion: Pawn promotion " << squareToCoords(src) << " -> " << squareToCoords(dst) << std::endl;
-                                encodeMove(src, dst, p, q, 0, 0, 0);
-                            }
-                            else {
-                                std::cout << "CheckEvasion: Pawn quiet move " << squareToCoords(src) << " -> " << squareToCoords(dst) << std::endl;
-                                encodeMove(src, dst, p, 0, 0, 0, 0);
-                            }
-                        }
-                    }
-                    int doubleDst = dst + 8;
-                    // if double push will block a check
-                    if(blockingMask & (1ULL << doubleDst)){
-                        if(src >= a7 && src <= h7 && (!get_bit(allPieces, doubleDst))){
-                            if(pawnAttacks[black][dst] & bitboards[P]){
-                                enpassant = dst;
-                                enpassantPiece = doubleDst;
-                                std::cout << "CheckEvasion: Move up twice (enemy can enpassant)" << squareToCoords(src) << " -> " << squareToCoords(doubleDst) << std::endl;
-                                encodeMove(src, doubleDst, p, 0, 0, 1, 0);
-                            }
-                            else {
-                                std::cout << "CheckEvasion: Move up twice " << squareToCoords(src) << " -> " << squareToCoords(doubleDst) << std::endl;
-                                encodeMove(src, doubleDst, p, 0, 0, 0, 0);
-                            }
-                        }
-                    }
-                    pop_bit(bitboard, src);
-                }
-            }
-        }
-        // knight
-
-        // knight captures checking piece
-        uint64_t evasionCaptures = knightAttacks[checkingPieceSquare] & (!side ? bitboards[N] : bitboards[n]);
-
-        while(evasionCaptures){
-            int src = getLsb(evasionCaptures);
-            std::cout << "CheckEvasion: Knight capture move " << squareToCoords(src) << " -> " << squareToCoords(checkingPieceSquare) << std::endl;
-            encodeMove(src, checkingPieceSquare, (!side ? N : n), 0, 1, 0, 0);
-            pop_bit(evasionCaptures, src);
-        }
-        // knight quiet moves
-        if(!onlyGenerateCaptures){
-            bitboard = !side ? bitboards[N] : bitboards[n];
-            while(bitboard){
-                int src = getLsb(bitboard);
-                attacks = knightAttacks[src] & (!side ? ~allWhites : ~allBlacks);
-                uint64_t quietBlocks = attacks & blockingMask;
-
-                while(quietBlocks){
-                    int target = getLsb(quietBlocks);
-                    std::cout << "CheckEvasion: Knight quiet move " << squareToCoords(src) << " -> " << squareToCoords(target) << std::endl;
-                    encodeMove(src, target, (!side ? N : n), 0, 0, 0, 0);
-                    pop_bit(quietBlocks, target);
-                }
-                pop_bit(bitboard, src);
-            }
-        }
-
-        // Bishop
-        bitboard = !side ? bitboards[B] : bitboards[b];
-        while(bitboard){
-            int src = getLsb(bitboard);
-            attacks = getBishopAttacks(src, allPieces) & (!side ? ~allWhites : ~allBlacks);
-            uint64_t quietBlocks = attacks & blockingMask;
-            uint64_t evasionCaptures = getBishopAttacks(checkingPieceSquare, allPieces) & (!side ? bitboards[B] : bitboards[b]);
-
-            // capture checking piece
-            while(evasionCaptures){
-                int src = getLsb(evasionCaptures);
-                std::cout << "CheckEvasion: Bishop capture move " << squareToCoords(src) << " -> " << squareToCoords(checkingPieceSquare) << std::endl;
-                encodeMove(src, checkingPieceSquare, (!side ? B : b), 0, 1, 0, 0);
-                pop_bit(evasionCaptures, src);
-            }
-            if(!onlyGenerateCaptures){
-                // quiet moves that block
-                while(quietBlocks){
-                    int target = getLsb(quietBlocks);
-                    std::cout << "CheckEvasion: Bishop quiet move " << squareToCoords(src) << " -> " << squareToCoords(target) << std::endl;
-                    encodeMove(src, target, (!side ? B : b), 0, 0, 0, 0);
-                    pop_bit(quietBlocks, target);
-                }
-            }
-            pop_bit(bitboard, src);
+        // double check, only the king can move
+        if(countBits(checkers) > 1){
+            return;
         }
 
-        // Rook
-        bitboard = !side ? bitboards[R] : bitboards[r];
-        while(bitboard){
-            int src = getLsb(bitboard);
-            attacks = getRookAttacks(src, allPieces) & (!side ? ~allWhites : ~allBlacks);
-            uint64_t quietBlocks = attacks & blockingMask;
-            uint64_t evasionCaptures = getRookAttacks(checkingPieceSquare, allPieces) & (!side ? bitboards[R] : bitboards[r]);
-
-            // capture checking piece
-            while(evasionCaptures){
-                int src = getLsb(evasionCaptures);
-                std::cout << "CheckEvasion: Rook capture move " << squareToCoords(src) << " -> " << squareToCoords(checkingPieceSquare) << std::endl;
-                encodeMove(src, checkingPieceSquare, (!side ? R : r), 0, 1, 0, 0);
-                pop_bit(evasionCaptures, src);
+        // in check every other move has to capture the checker or block between it and the king
+        uint64_t checkMask = ~0ULL;
+        if(checkers){
+            checkMask = checkers | attackTables.squaresBetween[kingSquare][getLsb(checkers)];
+        }
+
+        // Pins: look from the king through our own pieces (x-ray) for enemy sliders. If exactly
+        // one of our pieces is in between, it can only move along that line
+        uint64_t pinned = 0;
+        uint64_t pinRays[64];
+        uint64_t snipers = (getRookAttacks(kingSquare, enemyPieces) & (bitboards[R + enemy] | bitboards[Q + enemy]))
+                         | (getBishopAttacks(kingSquare, enemyPieces) & (bitboards[B + enemy] | bitboards[Q + enemy]));
+        while(snipers){
+            int sniper = getLsb(snipers);
+            uint64_t between = attackTables.squaresBetween[kingSquare][sniper] & allPieces;
+            if(countBits(between) == 1 && (between & ownPieces)){
+                pinned |= between;
+                pinRays[getLsb(between)] = attackTables.squaresBetween[kingSquare][sniper] | (1ULL << sniper);
             }
-            if(!onlyGenerateCaptures){
-                // quiet moves that block
-                while(quietBlocks){
-                    int target = getLsb(quietBlocks);
-                    std::cout << "CheckEvasion: Rook quiet move " << squareToCoords(src) << " -> " << squareToCoords(target) << std::endl;
-                    encodeMove(src, target, (!side ? R : r), 0, 0, 0, 0);
-                    pop_bit(quietBlocks, target);
-                }
-            }
-            pop_bit(bitboard, src);
+            pop_bit(snipers, sniper);
         }
 
-        // Queen
-        bitboard = !side ? bitboards[Q] : bitboards[q];
+        // Pawns
+        constexpr int forward = Us == white ? -8 : 8;
+        constexpr uint64_t startRank = Us == white ? 0x00ff000000000000ULL : 0x000000000000ff00ULL;
+        bitboard = bitboards[P + own];
         while(bitboard){
             int src = getLsb(bitboard);
-            attacks = getQueenAttacks(src, allPieces) & (!side ? ~allWhites : ~allBlacks);
-            uint64_t quietBlocks = attacks & blockingMask;
-            uint64_t evasionCaptures = getQueenAttacks(checkingPieceSquare, allPieces) & (!side ? bitboards[Q] : bitboards[q]);
-
-            // capture checking piece
-            while(evasionCaptures){
-                int src = getLsb(evasionCaptures);
-                std::cout << "CheckEvasion: Queen capture move " << squareToCoords(src) << " -> " << squareToCoords(checkingPieceSquare) << std::endl;
-                encodeMove(src, checkingPieceSquare, (!side ? Q : q), 0, 1, 0, 0);
-                pop_bit(evasionCaptures, src);
-            }
-            if(!onlyGenerateCaptures){
-                // quiet moves that block
-                while(quietBlocks){
-                    int target = getLsb(quietBlocks);
-                    std::cout << "CheckEvasion: Queen quiet move " << squareToCoords(src) << " -> " << squareToCoords(target) << std::endl;
-                    encodeMove(src, target, (!side ? Q : q), 0, 0, 0, 0);
-                    pop_bit(quietBlocks, target);
-                }
-            }
-
-            pop_bit(bitboard, src);
-        }
-    }
-
-    void generateMoves(){
-        // king is under check, generate strictly legal moves
-        if((!side && isSquareAttacked(getLsb(bitboards[K]), 1, nil)) || (side && isSquareAttacked(getLsb(bitboards[k]), 0, nil))){
-            generateLegalMoves();
-            return;
-        }
-
-        uint64_t bitboard, attacks;
-        moveCount = 0;
-        kingMoveCount = 0;
-
-        if(side == white){
-            // White pawn
-            //std::cout << "White moves: " << std::endl;
-            bitboard = bitboards[P];
+            uint64_t allowed = checkMask & (get_bit(pinned, src) ? pinRays[src] : ~0ULL);
+            int dst = src + forward;
 
-            while(bitboard){
-                int src = getLsb(bitboard);
-                // Forward push
-                int dst = src - 8;
-
-                if(dst >= a8 && !get_bit(allPieces, dst)){
-                    // Check for promotion
-                    if(dst < a7){
-                        //std::cout << "Pawn promotion " << squareToCoords(src) << " -> " << squareToCoords(dst) << std::endl;
-                        encodeMove(src, dst, P, Q, 0, 0, 0);
-                    }
-                    else {
-                        // Single push
-                        //std::cout << "Move up one " << squareToCoords(src) << " -> " << squareToCoords(dst) << std::endl;
-                        encodeMove(src, dst, P, 0, 0, 0, 0);
-                        if(src >= a2 && src <= h2 && (!get_bit(allPieces, dst - 8))){
-                            // Double push
-                            int doubleDst = dst - 8;
-                            //std::cout << "Move up twice " << squareToCoords(src) << " -> " << squareToCoords(doubleDst) << std::endl;
-
-                            if(pawnAttacks[white][dst] & bitboards[p]){
-                                enpassant = dst;
-                                enpassantPiece = doubleDst;
-                                encodeMove(src, doubleDst, P, 0, 0, 1, 0);
-                            }
-                            else {
-                                encodeMove(src, doubleDst, P, 0, 0, 0, 0);
-                            }
-                        }
-                    }
+            if(!get_bit(allPieces, dst)){
+                if(get_bit(allowed, dst)){
+                    encodePawnMove(list, src, dst, 0, type);
                 }
-
-                attacks = pawnAttacks[side][src] & allBlacks;
-
-                while(attacks){
-                    int attack = getLsb(attacks);
-                    if(attack < a7){
-                        //std::cout << "Pawn promotion capture " << squareToCoords(src) << " -> " << squareToCoords(attack) << std::endl;
-                        encodeMove(src, attack, P, Q, 1, 0, 0);
-                    }
-                    else {
-                        //std::cout << "Pawn capture " << squareToCoords(src) << " -> " << squareToCoords(attack) << std::endl;
-                        encodeMove(src, attack, P, 0, 1, 0, 0);
-                    }
-                    pop_bit(attacks, attack);
-                }
-
-                if(enpassant != nil){
-                    uint64_t enpassantAttacks = pawnAttacks[side][src] & (1ULL << enpassant);
-                    if(enpassantAttacks){
-                        int attack = getLsb(enpassantAttacks);
-                        //std::cout << "Pawn enpassant capture " << squareToCoords(src) << " -> " << squareToCoords(attack) << std::endl;
-                        encodeMove(src, attack, P, 0, 1, 0, 0);
-                    }
+                // Double push from the starting rank
+                int doubleDst = dst + forward;
+                if(type != captureMoves && get_bit(startRank, src) && !get_bit(allPieces, doubleDst) && get_bit(allowed, doubleDst)){
+                    encodeMove(list, src, doubleDst, doublePushFlag);
                 }
-
-                pop_bit(bitboard, src);
             }
 
-            // King Castling Moves
-            if(castle & wk){
-                // Make sure kingside squares are empty
-                if(!get_bit(allPieces, f1) && !get_bit(allPieces, g1)){
-                    if(!isSquareAttacked(e1, black, nil) && !isSquareAttacked(f1, black, nil)){
-                        //std::cout << "Castling move e1 -> g1" << std::endl;
-                        encodeMove(e1, g1, K, 0, 0, 0, 1);
-                    }
-                }
-            }
-            if(castle & wq){
-                // Make sure queenside squares are empty
-                if(!get_bit(allPieces, b1) && !get_bit(allPieces, c1) && !get_bit(allPieces, d1)){
-                    if(!isSquareAttacked(e1, black, nil) && !isSquareAttacked(d1, black, nil)){
-                        //std::cout << "Castling move e1 -> c1" << std::endl;
-                        encodeMove(e1, c1, K, 0, 0, 0, 1);
-                    }
-                }
+            attacks = type == quietMoves ? 0 : attackTables.pawnAttacks[Us][src] & enemyPieces & allowed;
+            while(attacks){
+                int target = getLsb(attacks);
+                encodePawnMove(list, src, target, 1, type);
+                pop_bit(attacks, target);
             }
-        }
-        else if(side == black){
-            //std::cout << "Black moves: " << std::endl;
-            // Black pawn
-            bitboard = bitboards[p];
-
-            while(bitboard){
-                int src = getLsb(bitboard);
-                // Forward push
-                int dst = src + 8;
-
-                if(dst <= h1 && !get_bit(allPieces, dst)){
-                    // Check for promotion
-                    if(dst >= a1){
-                        //std::cout << "Pawn promotion " << squareToCoords(src) << " -> " << squareToCoords(dst) << std::endl;
-                        encodeMove(src, dst, p, q, 0, 0, 0);
-                    }
-                    else {
-                        // Single push
-                        //std::cout << "Move up one " << squareToCoords(src) << " -> " << squareToCoords(dst) << std::endl;
-                        encodeMove(src, dst, p, 0, 0, 0, 0);
-                        if(src >= a7 && src <= h7 && (!get_bit(allPieces, dst + 8))){
-                            // Double push
-                            int doubleDst = dst + 8;
-                            //std::cout << "Move up twice " << squareToCoords(src) << " -> " << squareToCoords(doubleDst) << std::endl;
-                            if(pawnAttacks[black][dst] & bitboards[P]){
-                                enpassant = dst;
-                                enpassantPiece = doubleDst;
-                                encodeMove(src, doubleDst, p, 0, 0, 1, 0);
-                            }
-                            else {
-                                encodeMove(src, doubleDst, p, 0, 0, 0, 0);
-                            }
-                        }
-                    }
-                }
-
-                attacks = pawnAttacks[side][src] & allWhites;
-
-                while(attacks){
-                    int attack = getLsb(attacks);
-                    if(attack >= a1){
-                        //std::cout << "Pawn promotion capture " << squareToCoords(src) << " -> " << squareToCoords(attack) << std::endl;
-                        encodeMove(src, attack, p, q, 1, 0, 0);
-                    }
-                    else {
-                        //std::cout << "Pawn capture " << squareToCoords(src) << " -> " << squareToCoords(attack) << std::endl;
-                        encodeMove(src, attack, p, 0, 1, 0, 0);
-                    }
-                    pop_bit(attacks, attack);
-                }
 
-                if(enpassant != nil){
-                    uint64_t enpassantAttacks = pawnAttacks[side][src] & (1ULL << enpassant);
-                    if(enpassantAttacks){
-                        int attack = getLsb(enpassantAttacks);
-                        //std::cout << "Pawn enpassant capture " << squareToCoords(src) << " -> " << squareToCoords(attack) << std::endl;
-                        encodeMove(src, attack, p, 0, 1, 0, 0);
-                    }
-                }
-
-                pop_bit(bitboard, src);
+            if(type != quietMoves && enpassant != nil && get_bit(attackTables.pawnAttacks[Us][src], enpassant) && enpassantIsLegal(src, kingSquare, enemy, checkMask)){
+                encodeMove(list, src, enpassant, enpassantFlag);
             }
-            // King Castling Moves
-            if(castle & bk){
-                // Make sure kingside squares are empty
-                if(!get_bit(allPieces, f8) && !get_bit(allPieces, g8)){
-                    if(!isSquareAttacked(e8, white, nil) && !isSquareAttacked(f8, white, nil)){
-                        //std::cout << "Castling move e8 -> g8" << std::endl;
-                        encodeMove(e8, g8, k, 0, 0, 0, 1);
-                    }
-                }
 
-            }
-            if(castle & bq){
-                // Make sure queenside squares are empty
-                if(!get_bit(allPieces, b8) && !get_bit(allPieces, c8) && !get_bit(allPieces, d8)){
-                    if(!isSquareAttacked(e8, white, nil) && !isSquareAttacked(d8, white, nil)){
-                        //std::cout << "Castling move e8 -> c8" << std::endl;
-                        encodeMove(e8, c8, k, 0, 0, 0, 1);
-                    }
-                }
-            }
+            pop_bit(bitboard, src);
         }
 
-        // Knight
-        bitboard = !side ? bitboards[N] : bitboards[n];
+        // Knight, a pinned knight can never stay on its line
+        bitboard = bitboards[N + own] & ~pinned;
         while(bitboard){
             int src = getLsb(bitboard);
-            attacks = knightAttacks[src] & (!side ? ~allWhites : ~allBlacks);
-
-            while(attacks){
-                int target = getLsb(attacks);
-
-                // Quiet move
-                if(!get_bit((!side ? allBlacks : allWhites), target)){
-                    //std::cout << "Knight quiet move " << squareToCoords(src) << " -> " << squareToCoords(target) << std::endl;
-                    encodeMove(src, target, (!side ? N : n), 0, 0, 0, 0);
-                }
-                // Capture Move
-                else {
-                    //std::cout << "Knight capture move " << squareToCoords(src) << " -> " << squareToCoords(target) << std::endl;
-                    encodeMove(src, target, (!side ? N : n), 0, 1, 0, 0);
-                }
-
-                pop_bit(attacks, target);
-            }
+            encodeTargets(list, src, attackTables.knightAttacks[src] & targets & checkMask, enemyPieces);
             pop_bit(bitboard, src);
         }
 
         // Bishop
-        bitboard = !side ? bitboards[B] : bitboards[b];
+        bitboard = bitboards[B + own];
         while(bitboard){
             int src = getLsb(bitboard);
-            attacks = getBishopAttacks(src, allPieces) & (!side ? ~allWhites : ~allBlacks);
-
-            while(attacks){
-                int target = getLsb(attacks);
-
-                // Quiet move
-                if(!get_bit((!side ? allBlacks : allWhites), target)){
-                    //std::cout << "Bishop quiet move " << squareToCoords(src) << " -> " << squareToCoords(target) << std::endl;
-                    encodeMove(src, target, (!side ? B : b), 0, 0, 0, 0);
-                }
-                // Capture Move
-                else {
-                    //std::cout << "Bishop capture move " << squareToCoords(src) << " -> " << squareToCoords(target) << std::endl;
-                    encodeMove(src, target, (!side ? B : b), 0, 1, 0, 0);
-                }
-
-                pop_bit(attacks, target);
-            }
+            uint64_t allowed = checkMask & (get_bit(pinned, src) ? pinRays[src] : ~0ULL);
+            encodeTargets(list, src, getBishopAttacks(src, allPieces) & targets & allowed, enemyPieces);
             pop_bit(bitboard, src);
         }
 
         // Rook
-        bitboard = !side ? bitboards[R] : bitboards[r];
+        bitboard = bitboards[R + own];
         while(bitboard){
             int src = getLsb(bitboard);
-            attacks = getRookAttacks(src, allPieces) & (!side ? ~allWhites : ~allBlacks);
-
-            while(attacks){
-                int target = getLsb(attacks);
-
-                // Quiet move
-                if(!get_bit((!side ? allBlacks : allWhites), target)){
-                    //std::cout << "Rook quiet move " << squareToCoords(src) << " -> " << squareToCoords(target) << std::endl;
-                    encodeMove(src, target, (!side ? R : r), 0, 0, 0, 0);
-                }
-                // Capture Move
-                else {
-                    //std::cout << "Rook capture move " << squareToCoords(src) << " -> " << squareToCoords(target) << std::endl;
-                    encodeMove(src, target, (!side ? R : r), 0, 1, 0, 0);
-                }
-
-                pop_bit(attacks, target);
-            }
+            uint64_t allowed = checkMask & (get_bit(pinned, src) ? pinRays[src] : ~0ULL);
+            encodeTargets(list, src, getRookAttacks(src, allPieces) & targets & allowed, enemyPieces);
             pop_bit(bitboard, src);
         }
 
-
         // Queen
-        bitboard = !side ? bitboards[Q] : bitboards[q];
+        bitboard = bitboards[Q + own];
         while(bitboard){
             int src = getLsb(bitboard);
-            attacks = getQueenAttacks(src, allPieces) & (!side ? ~allWhites : ~allBlacks);
-
-            while(attacks){
-                int target = getLsb(attacks);
-
-                // Quiet move
-                if(!get_bit((!side ? allBlacks : allWhites), target)){
-                    //std::cout << "Queen quiet move " << squareToCoords(src) << " -> " << squareToCoords(target) << std::endl;
-                    encodeMove(src, target, (!side ? Q : q), 0, 0, 0, 0);
-                }
-                // Capture Move
-                else {
-                    //std::cout << "Queen capture move " << squareToCoords(src) << " -> " << squareToCoords(target) << std::endl;
-                    encodeMove(src, target, (!side ? Q : q), 0, 1, 0, 0);
-                }
+            uint64_t allowed = checkMask & (get_bit(pinned, src) ? pinRays[src] : ~0ULL);
+            encodeTargets(list, src, getQueenAttacks(src, allPieces) & targets & allowed, enemyPieces);
+            pop_bit(bitboard, src);
+        }
 
-                pop_bit(attacks, target);
+        // King Castling Moves, never out of check or across an attacked square.
+        // Written for black's back rank, white's is the same squares 56 further on
+        if(!checkers && type != captureMoves){
+            constexpr int rank = Us == white ? a1 - a8 : 0;
+            constexpr int kingside = Us == white ? wk : bk;
+            constexpr int queenside = Us == white ? wq : bq;
+            constexpr uint64_t kingsideEmpty = (1ULL << (f8 + rank)) | (1ULL << (g8 + rank));
+            constexpr uint64_t queensideEmpty = (1ULL << (b8 + rank)) | (1ULL << (c8 + rank)) | (1ULL << (d8 + rank));
+            constexpr uint64_t kingsideSafe = (1ULL << (f8 + rank)) | (1ULL << (g8 + rank));
+            constexpr uint64_t queensideSafe = (1ULL << (c8 + rank)) | (1ULL << (d8 + rank));
+            if((castle & kingside) && !(allPieces & kingsideEmpty) && !(threats & kingsideSafe)){
+                encodeMove(list, e8 + rank, g8 + rank, kingCastleFlag);
+            }
+            if((castle & queenside) && !(allPieces & queensideEmpty) && !(threats & queensideSafe)){
+                encodeMove(list, e8 + rank, c8 + rank, queenCastleFlag);
             }
-            pop_bit(bitboard, src);
         }
-        // King
-        bitboard = !side ? bitboards[K] : bitboards[k];
-        while(bitboard){
-            int src = getLsb(bitboard);
-            attacks = kingAttacks[src] & (!side ? ~allWhites : ~allBlacks);
+    }
 
-            while(attacks){
-                int target = getLsb(attacks);
+    // Number of legal moves (or captures, or quiets) without generating them.
+    // Perft leaves and mobility use this
+    int countMoves(int type = allMoves){
+        MoveCount moves;
+        generateMoves(moves, type);
+        return moves.count;
+    }
 
-                // Quiet move
-                if(!isSquareAttacked(target, !side, src) && (!get_bit((!side ? allBlacks : allWhites), target))){
-                    //std::cout << "King quiet move " << squareToCoords(src) << " -> " << squareToCoords(target) << std::endl;
-                    encodeMove(src, target, (!side ? K : k), 0, 0, 0, 0);
-                }
-                // Capture Move
-                else if(!isSquareAttacked(target, !side, src)){
-                    //std::cout << "King capture move " << squareToCoords(src) << " -> " << squareToCoords(target) << std::endl;
-                    encodeMove(src, target, (!side ? K : k), 0, 1, 0, 0);
-                }
+    // Captures, en passant and promotions only, for quiescence search: the pieces' attack
+    // sets against enemy occupancy, so no quiet move is ever generated
+    void generateCaptures(MoveList& list){
+        generateMoves(list, captureMoves);
+    }
 
-                pop_bit(attacks, target);
-            }
-            pop_bit(bitboard, src);
+    // one move per target square, captures onto enemy pieces first, then the quiet ones
+    template<typename Output>
+    void encodeTargets(Output& list, int src, uint64_t targets, uint64_t enemyPieces){
+        if constexpr(Output::countOnly){
+            list.count += countBits(targets);
+            return;
+        }
+        uint64_t captures = targets & enemyPieces;
+        targets ^= captures;
+        while(captures){
+            int target = getLsb(captures);
+            encodeMove(list, src, target, captureFlag);
+            pop_bit(captures, target);
         }
+        while(targets){
+            int target = getLsb(targets);
+            encodeMove(list, src, target, quietFlag);
+            pop_bit(targets, target);
+        }
+    }
+
+    //
+    // En passant removes two pawns from the same rank at once, which pin masks don't
+    // cover, so replay the capture on the occupancy and look for a slider on the king.
+    // It also answers a check when the pawn it takes is the checker.
+    //
+    bool enpassantIsLegal(int src, int kingSquare, int enemy, uint64_t checkMask){
+        if(!(checkMask & ((1ULL << enpassant) | (1ULL << enpassantPiece)))){
+            return false;
+        }
+        uint64_t occupancy = (allPieces ^ (1ULL << src) ^ (1ULL << enpassantPiece)) | (1ULL << enpassant);
+        uint64_t rookSliders = bitboards[R + enemy] | bitboards[Q + enemy];
+        uint64_t bishopSliders = bitboards[B + enemy] | bitboards[Q + enemy];
+        return !(getRookAttacks(kingSquare, occupancy) & rookSliders) && !(getBishopAttacks(kingSquare, occupancy) & bishopSliders);
     }
 };
\ No newline at end of file
@@ -0,0 +1,185 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include "MoveGenerator.h"
+
+//
+// Hands the search one move at a time in the order it wants to try them:
+// hash move, good captures, killers, quiet moves, bad captures.
+// Each stage is only generated once the one before it has run dry, so a node
+// that cuts off on the hash move or a capture never generates its quiets.
+//
+// Captures are ordered by MVV-LVA. A capture of a cheaper piece that loses material
+// by static exchange (MoveGenerator::see) is held back until after the quiets.
+// Quiets are ordered by the search's history table when it passes one.
+//
+// Quiescence search makes one with just the position: it returns the good captures
+// and stops, losing captures and underpromotions are never tried.
+//
+class MovePicker
+{
+public:
+    enum {
+        hashStage, captureGenStage, goodCaptureStage, killerStage, quietGenStage, quietStage, badCaptureStage, doneStage
+    };
+
+    // hashMove and killers are 0 when the search has none. history is the side to move's
+    // butterfly table, a score for each from and to square
+    MovePicker(MoveGenerator* mg, uint16_t hashMove, const uint16_t* killers, const int (*history)[64] = nullptr)
+        : _mg(mg), _hashMove(hashMove), _history(history){
+        _killers[0] = killers ? killers[0] : 0;
+        _killers[1] = killers && killers[1] != killers[0] ? killers[1] : 0;
+    }
+
+    // good captures only, for quiescence
+    explicit MovePicker(MoveGenerator* mg) : _mg(mg), _hashMove(0), _history(nullptr), _capturesOnly(true){
+        _killers[0] = 0;
+        _killers[1] = 0;
+        _stage = captureGenStage;
+    }
+
+    // next move to search, 0 once every legal move has been returned
+    uint16_t next(){
+        switch(_stage){
+            case hashStage:
+                _stage = captureGenStage;
+                if(_mg->isLegal(_hashMove)){
+                    return _hashMove;
+                }
+                // not playable here, so the generated stages must not skip it
+                _hashMove = 0;
+                [[fallthrough]];
+
+            case captureGenStage:
+                // generated straight into _moves, then bad captures are moved out
+                _mg->generateCaptures(_moves);
+                for(int i = 0; i < _moves.count; i++){
+                    uint16_t move = _moves[i];
+                    if(move == _hashMove){
+                        continue;
+                    }
+                    int score = captureScore(move);
+                    if(score < 0){
+                        _badCaptures.add(move);
+                    }
+                    else {
+                        _moves.moves[_count] = move;
+                        _scores[_count++] = score;
+                    }
+                }
+                _stage = goodCaptureStage;
+                [[fallthrough]];
+
+            case goodCaptureStage:
+                if(_index < _count){
+                    return pickBest();
+                }
+                if(_capturesOnly){
+                    _stage = doneStage;
+                    return 0;
+                }
+                _stage = killerStage;
+                [[fallthrough]];
+
+            case killerStage:
+                while(_killerIndex < 2){
+                    uint16_t& killer = _killers[_killerIndex++];
+                    if(killer != _hashMove && !_mg->getCapture(killer) && !_mg->getPromotedPiece(killer) && _mg->isLegal(killer)){
+                        return killer;
+                    }
+                    // same as the hash move, a capture here, or not playable
+                    killer = 0;
+                }
+                _stage = quietGenStage;
+                [[fallthrough]];
+
+            case quietGenStage:
+                _mg->generateMoves(_moves, MoveGenerator::quietMoves);
+                _count = 0;
+                _index = 0;
+                for(int i = 0; i < _moves.count; i++){
+                    uint16_t move = _moves[i];
+                    if(move != _hashMove && move != _killers[0] && move != _killers[1]){
+                        _scores[_count] = _history ? _history[_mg->getSrc(move)][_mg->getDst(move)] : 0;
+                        _moves.moves[_count++] = move;
+                    }
+                }
+                _stage = quietStage;
+                [[fallthrough]];
+
+            case quietStage:
+                if(_index < _count){
+                    return _history ? pickBest() : _moves[_index++];
+                }
+                _stage = badCaptureStage;
+                [[fallthrough]];
+
+            case badCaptureStage:
+                if(_badIndex < _badCaptures.count){
+                    return _badCaptures[_badIndex++];
+                }
+                _stage = doneStage;
+                [[fallthrough]];
+
+            default:
+                return 0;
+        }
+    }
+
+    int stage(){ return _stage; }
+
+    // MVV-LVA: most valuable victim first, cheapest attacker breaks ties.
+    // Negative for captures that give up material once the exchange plays out
+    int captureScore(uint16_t move){
+        int attacker = _mg->getPiece(move) % 6;
+        int victim = _mg->getEnpassant(move) ? MoveGenerator::P : _mg->pieceOn[_mg->getDst(move)] % 6;
+        int promoted = _mg->getPromotedPiece(move);
+        int score = 0;
+        if(_mg->getCapture(move)){
+            score = pieceValues[victim] * 8 - attacker;
+            // a cheaper victim is only bad if the static exchange says it loses material
+            if(pieceValues[victim] < pieceValues[attacker] && !_mg->seeGreaterEqual(move, 0)){
+                score = -1;
+            }
+        }
+        // queening is worth about a queen, underpromotions go to the back
+        if(promoted){
+            score = promoted % 6 == MoveGenerator::Q ? score + pieceValues[MoveGenerator::Q] * 8 : -1;
+        }
+        return score;
+    }
+
+private:
+    // selection sort one step at a time, most captures are never looked at
+    uint16_t pickBest(){
+        int best = _index;
+        for(int i = _index + 1; i < _count; i++){
+            if(_scores[i] > _scores[best]){
+                best = i;
+            }
+        }
+        std::swap(_moves.moves[_index], _moves.moves[best]);
+        std::swap(_scores[_index], _scores[best]);
+        return _moves[_index++];
+    }
+
+    static constexpr int pieceValues[6] = { 1, 3, 3, 5, 9, 0 };
+
+    MoveGenerator* _mg;
+    uint16_t _hashMove;
+    uint16_t _killers[2];
+    const int (*_history)[64];
+    bool _capturesOnly = false;
+    int _stage = hashStage;
+
+    // good captures, then reused for the quiets, with their scores. _count of them are left after filtering
+    MoveList _moves;
+    int _scores[MoveList::maxMoves];
+    int _count = 0;
+    int _index = 0;
+
+    MoveList _badCaptures;
+    int _badIndex = 0;
+
+    int _killerIndex = 0;
+};
@@ -0,0 +1,223 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "MoveGenerator.h"
+
+//
+// perft: count the leaf nodes of the move tree to a fixed depth.
+// the counts are published for many positions, so this checks the move
+// generator and doubles as its benchmark.
+//
+inline uint64_t perft(MoveGenerator* mg, int depth){
+    int i;
+    uint64_t nodes = 0;
+
+    if(depth == 0)
+        return 1ULL;
+    // bulk count: the leaves are just the number of legal moves here
+    if(depth == 1)
+        return mg->countMoves();
+
+    MoveList moveList;
+    mg->generateMoves(moveList);
+
+    MoveGenerator::UndoRecord undo;
+    for(i = 0; i < moveList.count; i++){
+        mg->makeMove(moveList[i], undo);
+        nodes += perft(mg, depth - 1);
+        mg->unmakeMove(moveList[i], undo);
+    }
+    return nodes;
+}
+
+//
+// Subtree counts shared by every perft thread, keyed by Zobrist key and depth.
+// There are no locks: an entry holds key ^ data next to data, so a probe that
+// reads the two halves of different stores gets a key that doesn't match and
+// treats it as a miss. Buckets are two entries, one kept for the deepest
+// subtree seen and one always replaced.
+//
+class PerftTable {
+public:
+    // the largest power-of-two number of buckets that fits in megabytes
+    explicit PerftTable(size_t megabytes){
+        size_t buckets = 1;
+        while(buckets * 2 * sizeof(Bucket) <= megabytes * 1024 * 1024){
+            buckets *= 2;
+        }
+        _buckets = std::make_unique<Bucket[]>(buckets);
+        _mask = buckets - 1;
+        _bytes = buckets * sizeof(Bucket);
+    }
+
+    bool probe(uint64_t key, int depth, uint64_t& nodes) const {
+        const Bucket& bucket = _buckets[key & _mask];
+        for(const Entry& entry : bucket.entries){
+            uint64_t data = entry.data.load(std::memory_order_relaxed);
+            uint64_t check = entry.check.load(std::memory_order_relaxed);
+            if((check ^ data) == key && int(data & depthMask) == depth){
+                nodes = data >> depthBits;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void store(uint64_t key, int depth, uint64_t nodes){
+        Bucket& bucket = _buckets[key & _mask];
+        uint64_t data = (nodes << depthBits) | uint64_t(depth);
+        int deepest = int(bucket.entries[0].data.load(std::memory_order_relaxed) & depthMask);
+        Entry& entry = depth >= deepest ? bucket.entries[0] : bucket.entries[1];
+        entry.check.store(key ^ data, std::memory_order_relaxed);
+        entry.data.store(data, std::memory_order_relaxed);
+    }
+
+    size_t bytes() const { return _bytes; }
+
+private:
+    // depth in the low bits of data, the count above it
+    static constexpr int depthBits = 6;
+    static constexpr uint64_t depthMask = (1ULL << depthBits) - 1;
+
+    struct Entry {
+        std::atomic<uint64_t> check{0};
+        std::atomic<uint64_t> data{0};
+    };
+    struct Bucket {
+        Entry entries[2];
+    };
+
+    std::unique_ptr<Bucket[]> _buckets;
+    uint64_t _mask = 0;
+    size_t _bytes = 0;
+};
+
+// one per thread, each on its own cache line, so counting hits doesn't make threads fight
+struct alignas(64) PerftStats {
+    uint64_t probes = 0;
+    uint64_t hits = 0;
+};
+
+// perft that looks subtrees up in table first. Depth 1 is a plain move count, cheaper than a probe
+inline uint64_t perftHashed(MoveGenerator* mg, int depth, PerftTable& table, PerftStats& stats){
+    if(depth <= 1)
+        return perft(mg, depth);
+
+    uint64_t nodes = 0;
+    stats.probes++;
+    if(table.probe(mg->hash, depth, nodes)){
+        stats.hits++;
+        return nodes;
+    }
+
+    MoveList moveList;
+    mg->generateMoves(moveList);
+    MoveGenerator::UndoRecord undo;
+    for(uint16_t move : moveList){
+        mg->makeMove(move, undo);
+        nodes += perftHashed(mg, depth - 1, table, stats);
+        mg->unmakeMove(move, undo);
+    }
+    table.store(mg->hash, depth, nodes);
+    return nodes;
+}
+
+// one unit of work for perftParallel: the subtree under the first one or two plies
+struct PerftJob {
+    uint16_t moves[2];
+    int      plies;
+    uint64_t nodes;
+};
+
+struct PerftResult {
+    uint64_t              nodes = 0;
+    std::vector<PerftJob> jobs;          // in root move order, for divide
+    std::vector<uint64_t> threadNodes;   // leaves counted by each worker
+    PerftStats            hashStats;     // summed over the workers when a table is used
+};
+
+//
+// perft spread over threads. The root moves, or the first two plies when the tree is
+// deep enough, become jobs that workers take off a shared counter, each worker on
+// its own copy of the position. Two plies give a few hundred jobs instead of a few
+// dozen, so one long subtree doesn't leave the other threads waiting.
+// With a table, all the workers share it and count transpositions once.
+//
+inline PerftResult perftParallel(const MoveGenerator& position, int depth, int threads, PerftTable* table = nullptr){
+    PerftResult result;
+    MoveGenerator root(position);
+    int plies = depth >= 3 ? 2 : 1;
+
+    MoveList rootMoves;
+    root.generateMoves(rootMoves);
+    for(uint16_t move : rootMoves){
+        if(plies == 1){
+            result.jobs.push_back({ { move, 0 }, 1, 0 });
+            continue;
+        }
+        MoveList replies;
+        MoveGenerator::UndoRecord undo;
+        root.makeMove(move, undo);
+        root.generateMoves(replies);
+        root.unmakeMove(move, undo);
+        for(uint16_t reply : replies){
+            result.jobs.push_back({ { move, reply }, 2, 0 });
+        }
+        // no replies: the root move ends the game and its subtree has no leaves
+    }
+
+    if(depth < 2){
+        // each root move is one leaf, nothing worth a thread
+        for(PerftJob& job : result.jobs){
+            job.nodes = 1;
+        }
+        result.nodes = depth == 1 ? rootMoves.count : 1;
+        result.threadNodes.assign(1, result.nodes);
+        return result;
+    }
+
+    threads = std::max(1, threads);
+    result.threadNodes.assign(threads, 0);
+    std::vector<PerftStats> threadStats(threads);
+    std::atomic<size_t> nextJob{0};
+    auto worker = [&](int thread){
+        MoveGenerator mg(position);
+        uint64_t nodes = 0;
+        MoveGenerator::UndoRecord undo[2];
+        for(size_t job = nextJob++; job < result.jobs.size(); job = nextJob++){
+            PerftJob& work = result.jobs[job];
+            for(int i = 0; i < work.plies; i++){
+                mg.makeMove(work.moves[i], undo[i]);
+            }
+            work.nodes = table ? perftHashed(&mg, depth - work.plies, *table, threadStats[thread])
+                               : perft(&mg, depth - work.plies);
+            for(int i = work.plies - 1; i >= 0; i--){
+                mg.unmakeMove(work.moves[i], undo[i]);
+            }
+            nodes += work.nodes;
+        }
+        result.threadNodes[thread] = nodes;
+    };
+
+    std::vector<std::thread> workers;
+    for(int i = 0; i < threads; i++){
+        workers.emplace_back(worker, i);
+    }
+    for(std::thread& thread : workers){
+        thread.join();
+    }
+
+    for(const PerftJob& job : result.jobs){
+        result.nodes += job.nodes;
+    }
+    for(const PerftStats& stats : threadStats){
+        result.hashStats.probes += stats.probes;
+        result.hashStats.hits += stats.hits;
+    }
+    return result;
+}
@@ -0,0 +1,164 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// what a probe found: the best move and score stored for the position
+struct TTEntry {
+    uint16_t move = 0;
+    int      score = 0;
+    int      depth = 0;
+    int      bound = 0;
+};
+
+// counted by the search that owns them, one per thread so threads don't share the line
+struct alignas(64) TTStats {
+    uint64_t probes = 0;
+    uint64_t hits = 0;
+    uint64_t stores = 0;
+};
+
+//
+// Search results keyed by Zobrist key, kept between searches so the next move
+// starts with what the last one learned.
+//
+// Like the PerftTable there are no locks: each entry holds key ^ data next to
+// data, and a probe that reads halves of two different stores sees a key that
+// doesn't match, so it misses instead of using a torn entry. A bucket is four
+// 16-byte entries on one 64-byte cache line, so a probe costs one memory access.
+//
+// Each entry records the search it came from (its age). An entry from an older
+// search is the first to go, then the shallowest.
+//
+class TranspositionTable {
+public:
+    // how the stored score relates to the real one: exact, at most (failed low) or at least (failed high)
+    enum {
+        noBound, upperBound, lowerBound, exactBound
+    };
+
+    explicit TranspositionTable(size_t megabytes){
+        resize(megabytes);
+    }
+
+    // the largest power-of-two number of buckets that fits in megabytes, emptied
+    void resize(size_t megabytes){
+        size_t buckets = 1;
+        while(buckets * 2 * sizeof(Bucket) <= megabytes * 1024 * 1024){
+            buckets *= 2;
+        }
+        _buckets = std::make_unique<Bucket[]>(buckets);
+        _mask = buckets - 1;
+        _bytes = buckets * sizeof(Bucket);
+        _age = 0;
+    }
+
+    void clear(){
+        for(size_t i = 0; i <= _mask; i++){
+            for(Entry& entry : _buckets[i].entries){
+                entry.check.store(0, std::memory_order_relaxed);
+                entry.data.store(0, std::memory_order_relaxed);
+            }
+        }
+        _age = 0;
+    }
+
+    // call once per search, what's stored from here on is newer than everything before
+    void newSearch(){
+        _age = (_age + 1) & ageMask;
+    }
+
+    bool probe(uint64_t key, TTEntry& found) const {
+        const Bucket& bucket = _buckets[key & _mask];
+        for(const Entry& entry : bucket.entries){
+            uint64_t data = entry.data.load(std::memory_order_relaxed);
+            uint64_t check = entry.check.load(std::memory_order_relaxed);
+            if(data && (check ^ data) == key){
+                found.move = uint16_t(data);
+                found.score = int16_t(data >> scoreShift);
+                found.depth = int((data >> depthShift) & 0xff);
+                found.bound = int((data >> boundShift) & 3);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void store(uint64_t key, uint16_t move, int score, int depth, int bound){
+        Bucket& bucket = _buckets[key & _mask];
+        // the entry already holding this position, otherwise the least worth keeping
+        Entry* replace = &bucket.entries[0];
+        int replaceWorth = 1 << 30;
+        for(Entry& entry : bucket.entries){
+            uint64_t data = entry.data.load(std::memory_order_relaxed);
+            if(data && (entry.check.load(std::memory_order_relaxed) ^ data) == key){
+                // keep the old best move when this search didn't find one
+                if(!move){
+                    move = uint16_t(data);
+                }
+                replace = &entry;
+                break;
+            }
+            int worth = worthKeeping(data);
+            if(worth < replaceWorth){
+                replaceWorth = worth;
+                replace = &entry;
+            }
+        }
+        uint64_t data = uint64_t(move)
+                      | (uint64_t(uint16_t(int16_t(score))) << scoreShift)
+                      | (uint64_t(depth & 0xff) << depthShift)
+                      | (uint64_t(bound) << boundShift)
+                      | (uint64_t(_age) << ageShift);
+        replace->check.store(key ^ data, std::memory_order_relaxed);
+        replace->data.store(data, std::memory_order_relaxed);
+    }
+
+    // per mille of entries written by the current search, sampled from the first 250 buckets
+    int fill() const {
+        size_t buckets = std::min<size_t>(250, _mask + 1);
+        int used = 0;
+        for(size_t i = 0; i < buckets; i++){
+            for(const Entry& entry : _buckets[i].entries){
+                uint64_t data = entry.data.load(std::memory_order_relaxed);
+                used += data && int((data >> ageShift) & ageMask) == _age;
+            }
+        }
+        return int(used * 1000 / (buckets * bucketEntries));
+    }
+
+    size_t bytes() const { return _bytes; }
+
+private:
+    // data: move in the low 16 bits, then score, depth, bound and age
+    static constexpr int scoreShift = 16;
+    static constexpr int depthShift = 32;
+    static constexpr int boundShift = 40;
+    static constexpr int ageShift = 42;
+    static constexpr int ageMask = 63;
+    static constexpr int bucketEntries = 4;
+
+    // empty entries go first, then ones from older searches, then shallow ones
+    int worthKeeping(uint64_t data) const {
+        if(!data){
+            return -1000;
+        }
+        int age = (_age - int((data >> ageShift) & ageMask)) & ageMask;
+        return int((data >> depthShift) & 0xff) - 8 * age;
+    }
+
+    struct Entry {
+        std::atomic<uint64_t> check{0};
+        std::atomic<uint64_t> data{0};
+    };
+    struct alignas(64) Bucket {
+        Entry entries[bucketEntries];
+    };
+
+    std::unique_ptr<Bucket[]> _buckets;
+    uint64_t _mask = 0;
+    size_t _bytes = 0;
+    int _age = 0;
+};
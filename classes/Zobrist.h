@@ -1,3 +1,6 @@
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
 
 //
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+
+//
+// Random keys for hashing a chess position: one per piece on each square, one for
+// black to move, one per castling rights combination and one per en passant file.
+// A position's key is the XOR of the keys of everything in it, so MoveGenerator keeps
+// it up to date by XORing in and out just what a move changes.
+//
+// The keys come from a fixed-seed xorshift64*, built by the compiler, so they are
+// the same on every run and every machine. Keys saved in a table or a test stay valid.
+//
+class ZobristKeys {
+public:
+    constexpr ZobristKeys(){
+        uint64_t state = 0x9e3779b97f4a7c15ULL;
+        for(int piece = 0; piece < 12; piece++){
+            for(int square = 0; square < 64; square++){
+                pieceSquare[piece][square] = next(state);
+            }
+        }
+        side = next(state);
+        for(int rights = 0; rights < 16; rights++){
+            castle[rights] = next(state);
+        }
+        for(int file = 0; file < 8; file++){
+            enpassantFile[file] = next(state);
+        }
+    }
+
+    uint64_t pieceSquare[12][64] = {};
+    uint64_t side = 0;
+    uint64_t castle[16] = {};
+    uint64_t enpassantFile[8] = {};
+
+private:
+    // xorshift64*, the same generator tools/magics.cpp searches with
+    static constexpr uint64_t next(uint64_t& state){
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ULL;
+    }
+};
+
+inline constexpr ZobristKeys zobristKeys{};
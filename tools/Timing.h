@@ -0,0 +1,19 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+//
+// timing helpers shared by the headless tools
+//
+
+using Clock = std::chrono::steady_clock;
+
+inline double elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+inline uint64_t nodesPerSecond(uint64_t nodes, double ms)
+{
+    return ms > 0 ? (uint64_t)(nodes * 1000.0 / ms) : 0;
+}
@@ -0,0 +1,350 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include "../classes/AttackTables.h"
+#include "../classes/MoveGenerator.h"
+#include "../classes/Perft.h"
+#include "../classes/ChessAI.h"
+#include "Timing.h"
+
+//
+// headless benchmarks for the move generator, run with ./bench
+// build once with -DCHESS_USE_PEXT=ON and once without to compare slider backends
+//
+
+// results land here so the timed loops can't be optimised away
+static volatile uint64_t benchSink;
+
+// perft and search runs are a few ms each, so they are timed this many times and the fastest is reported
+static const int benchRepeats = 5;
+
+struct BenchPosition {
+    const char* name;
+    const char* fen;
+    int         depth;
+};
+
+static const BenchPosition benchPositions[] = {
+    { "initial",  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 4 },
+    { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 3 },
+};
+
+//
+// what startup used to pay: building every table at runtime, versus the baked attackTables
+//
+// every word of the tables added up, so each page of them is read
+static uint64_t tableChecksum(const AttackTables& tables)
+{
+    const uint64_t* words = reinterpret_cast<const uint64_t*>(&tables);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < sizeof(AttackTables) / sizeof(uint64_t); i++)
+        sum += words[i];
+    return sum;
+}
+
+//
+// the baked tables do no work until they are used. The first read of all of them
+// is the most they can cost a run, paging them in from the binary; the second
+// read is the same loop with them already in memory
+//
+static void benchStartup()
+{
+    auto start = Clock::now();
+    uint64_t sum = tableChecksum(attackTables);
+    double firstTouchMs = elapsedMs(start);
+
+    start = Clock::now();
+    sum += tableChecksum(attackTables);
+    double warmMs = elapsedMs(start);
+
+    start = Clock::now();
+    auto tables = std::make_unique<AttackTables>();
+    double runtimeMs = elapsedMs(start);
+
+    bool same = std::memcmp(tables.get(), &attackTables, sizeof(AttackTables)) == 0;
+    benchSink = sum;
+
+    std::cout << "startup: attack tables built at runtime  " << runtimeMs << " ms" << std::endl;
+    std::cout << "startup: baked tables, first read        " << firstTouchMs << " ms (" << sizeof(AttackTables) / 1024
+              << " KB read-only data)" << std::endl;
+    std::cout << "startup: baked tables, read again        " << warmMs << " ms" << std::endl;
+    std::cout << "startup: runtime and baked tables " << (same ? "match" : "DIFFER") << std::endl;
+}
+
+//
+// raw slider lookups over a fixed set of random occupancies
+//
+static void benchSliders()
+{
+    const int occupancyCount = 4096;
+    const int rounds = 64;
+    static uint64_t occupancies[occupancyCount];
+
+    // xorshift64, fixed seed so every run looks up the same boards
+    uint64_t seed = 0x9e3779b97f4a7c15ULL;
+    for (int i = 0; i < occupancyCount; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        occupancies[i] = seed & (seed >> 5);
+    }
+
+    uint64_t sink = 0;
+    auto start = Clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (int i = 0; i < occupancyCount; i++) {
+            int square = (i + round) & 63;
+            sink ^= attackTables.getRookAttacks(square, occupancies[i]);
+            sink ^= attackTables.getBishopAttacks(square, occupancies[i]);
+        }
+    }
+    double ms = elapsedMs(start);
+    uint64_t lookups = 2ULL * rounds * occupancyCount;
+
+    std::cout << "sliders: " << AttackTables::sliderBackend << " backend, " << lookups << " lookups in " << ms << " ms ("
+              << (ms * 1e6 / lookups) << " ns/lookup, checksum " << std::hex << sink << std::dec << ")" << std::endl;
+}
+
+//
+// the old layout, a full 4096 (rook) or 512 (bishop) slots per square, rebuilt here
+// so scattered lookups can be compared against the packed attackTables
+//
+struct UnpackedMagicTables {
+    uint64_t bishopAttacks[64][512];
+    uint64_t rookAttacks[64][4096];
+
+    UnpackedMagicTables()
+    {
+        for (int square = 0; square < 64; square++) {
+            uint64_t bishopMask = AttackTables::generateBishopAttack(square);
+            uint64_t occupancy = 0;
+            do {
+                int index = (occupancy * bishop_magic_numbers[square]) >> (64 - bishop_magic_bits[square]);
+                bishopAttacks[square][index] = AttackTables::generateBlockedBishopAttack(square, occupancy);
+                occupancy = (occupancy - bishopMask) & bishopMask;
+            } while (occupancy);
+
+            uint64_t rookMask = AttackTables::generateRookAttack(square);
+            occupancy = 0;
+            do {
+                int index = (occupancy * rook_magic_numbers[square]) >> (64 - rook_magic_bits[square]);
+                rookAttacks[square][index] = AttackTables::generateBlockedRookAttack(square, occupancy);
+                occupancy = (occupancy - rookMask) & rookMask;
+            } while (occupancy);
+        }
+    }
+
+    uint64_t getRookAttacks(int square, uint64_t occupancy) const
+    {
+        occupancy &= attackTables.rookMasks[square];
+        return rookAttacks[square][(occupancy * rook_magic_numbers[square]) >> (64 - rook_magic_bits[square])];
+    }
+
+    uint64_t getBishopAttacks(int square, uint64_t occupancy) const
+    {
+        occupancy &= attackTables.bishopMasks[square];
+        return bishopAttacks[square][(occupancy * bishop_magic_numbers[square]) >> (64 - bishop_magic_bits[square])];
+    }
+};
+
+//
+// random square and occupancy on every lookup, so the whole table is in play
+// and the timing shows how much of it stays in cache
+//
+template <typename Tables>
+static double scatteredLookupNs(const Tables& tables, uint64_t& sink)
+{
+    const int lookups = 1 << 22;
+    uint64_t seed = 0x2545f4914f6cdd1dULL;
+    auto start = Clock::now();
+    for (int i = 0; i < lookups; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        int square = seed & 63;
+        uint64_t occupancy = seed & (seed >> 7);
+        sink ^= tables.getRookAttacks(square, occupancy);
+        sink ^= tables.getBishopAttacks(square, occupancy >> 3);
+    }
+    return elapsedMs(start) * 1e6 / (2.0 * lookups);
+}
+
+static void benchSliderLayout()
+{
+    auto unpacked = std::make_unique<UnpackedMagicTables>();
+    uint64_t packedSink = 0;
+    uint64_t unpackedSink = 0;
+
+    // warm both up once before timing
+    scatteredLookupNs(attackTables, packedSink);
+    scatteredLookupNs(*unpacked, unpackedSink);
+
+    double packedNs = scatteredLookupNs(attackTables, packedSink);
+    double unpackedNs = scatteredLookupNs(*unpacked, unpackedSink);
+    size_t packedKB = (sizeof(attackTables.rookAttacks) + sizeof(attackTables.bishopAttacks)) / 1024;
+
+    std::cout << "layout: packed " << AttackTables::sliderBackend << " tables  " << packedKB << " KB  " << packedNs << " ns/lookup (scattered)" << std::endl;
+    std::cout << "layout: unpacked magic tables  " << sizeof(UnpackedMagicTables) / 1024 << " KB  " << unpackedNs << " ns/lookup (scattered)" << std::endl;
+    std::cout << "layout: results " << (packedSink == unpackedSink ? "match" : "DIFFER") << std::endl;
+}
+
+static void benchPerft()
+{
+    MoveGenerator mg;
+    for (const BenchPosition& position : benchPositions) {
+        mg.parseFen(position.fen);
+        uint64_t nodes = 0;
+        double ms = 1e9;
+        for (int run = 0; run < benchRepeats; run++) {
+            auto start = Clock::now();
+            nodes = perft(&mg, position.depth);
+            ms = std::min(ms, elapsedMs(start));
+        }
+        std::cout << "perft: " << position.name << " depth " << position.depth << "  " << nodes << " nodes  "
+                  << ms << " ms  " << nodesPerSecond(nodes, ms) << " nps" << std::endl;
+    }
+}
+
+static const BenchPosition tacticalPositions[] = {
+    { "kiwipete",   "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 0 },
+    { "position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 0 },
+    { "position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 0 },
+    { "position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 0 },
+};
+
+//
+// what a quiescence node pays: the captures-only generator versus the full list
+//
+static void benchCaptures()
+{
+    const int rounds = 200000;
+    MoveGenerator mg;
+    MoveList moves;
+    for (const BenchPosition& position : tacticalPositions) {
+        mg.parseFen(position.fen);
+        uint64_t sink = 0;
+
+        auto start = Clock::now();
+        for (int i = 0; i < rounds; i++) {
+            mg.generateMoves(moves);
+            sink += moves.count;
+        }
+        double fullNs = elapsedMs(start) * 1e6 / rounds;
+        int fullCount = moves.count;
+
+        start = Clock::now();
+        for (int i = 0; i < rounds; i++) {
+            mg.generateCaptures(moves);
+            sink += moves.count;
+        }
+        double capturesNs = elapsedMs(start) * 1e6 / rounds;
+
+        std::cout << "captures: " << position.name << "  all " << fullCount << " moves " << fullNs << " ns  captures "
+                  << moves.count << " moves " << capturesNs << " ns  (" << fullNs / capturesNs << "x)" << std::endl;
+        benchSink = sink;
+    }
+}
+
+static void benchSearch()
+{
+    for (const BenchPosition& position : benchPositions) {
+        ChessAI ai;
+        ai._mg = std::make_unique<MoveGenerator>();
+        ai._mg->parseFen(position.fen);
+        int score = 0;
+        double ms = 1e9;
+        for (int run = 0; run < benchRepeats; run++) {
+            ai.nodes = 0;
+            ai.qnodes = 0;
+            auto start = Clock::now();
+            score = ai.negamax(-9999, 9999, position.depth - 1);
+            ms = std::min(ms, elapsedMs(start));
+        }
+        std::cout << "search: " << position.name << " depth " << position.depth - 1 << "  score " << score << "  "
+                  << ai.nodes << " nodes (" << ai.qnodes << " quiescence)  " << ms << " ms  " << nodesPerSecond(ai.nodes, ms) << " nps" << std::endl;
+    }
+}
+
+//
+// iterative deepening against the clock: how deep it gets, and that it stays inside the hard limit.
+// run without and then with a transposition table
+//
+static void benchTimedSearch()
+{
+    for (int hashMegabytes : { 0, 16 }) {
+        for (const BenchPosition& position : benchPositions) {
+            ChessAI ai;
+            ai._mg = std::make_unique<MoveGenerator>();
+            ai._mg->parseFen(position.fen);
+            std::unique_ptr<TranspositionTable> table;
+            if (hashMegabytes) {
+                table = std::make_unique<TranspositionTable>(hashMegabytes);
+                ai._tt = table.get();
+            }
+            SearchLimits limits;
+            limits.softMs = 100;
+            limits.hardMs = 200;
+            SearchResult result = ai.search(limits);
+            std::cout << "timed search: " << position.name << "  hash " << hashMegabytes << " MB  depth " << result.depth << "  "
+                      << ai._mg->moveToString(result.move) << "  " << result.nodes << " nodes (" << result.qnodes << " quiescence)  " << result.ms << " ms  branching "
+                      << result.branching
+                      << (result.ms > limits.hardMs * 1.05 ? "  OVER BUDGET" : "") << std::endl;
+            if (table) {
+                double hitRate = result.tt.probes ? 100.0 * result.tt.hits / result.tt.probes : 0;
+                std::cout << "  hash: " << result.tt.probes << " probes  " << hitRate << "% hits  "
+                          << result.tt.stores << " stores  " << result.ttFill / 10.0 << "% full" << std::endl;
+            }
+        }
+    }
+}
+
+//
+// the selective search switched off entirely, one part at a time, then all on:
+// how deep each gets in the same time
+//
+static void benchSelectiveSearch()
+{
+    struct Selection {
+        const char*   name;
+        SearchOptions options;
+    };
+    const Selection selections[] = {
+        { "none", { false, false, false, false } },
+        { "null move", { true, false, false, false } },
+        { "reductions", { false, true, false, false } },
+        { "futility", { false, false, true, false } },
+        { "razoring", { false, false, false, true } },
+        { "all", { true, true, true, true } },
+    };
+    for (const BenchPosition& position : benchPositions) {
+        for (const Selection& selection : selections) {
+            ChessAI ai;
+            ai._mg = std::make_unique<MoveGenerator>();
+            ai._mg->parseFen(position.fen);
+            TranspositionTable table(16);
+            ai._tt = &table;
+            ai.options = selection.options;
+            SearchLimits limits;
+            limits.softMs = 200;
+            limits.hardMs = 400;
+            SearchResult result = ai.search(limits);
+            std::cout << "selective search: " << position.name << "  " << selection.name << "  depth " << result.depth << "  "
+                      << ai._mg->moveToString(result.move) << "  score " << result.score << "  " << result.nodes << " nodes  "
+                      << result.ms << " ms  branching " << result.branching << std::endl;
+        }
+    }
+}
+
+int main()
+{
+    benchStartup();
+    benchSliders();
+    benchSliderLayout();
+    benchPerft();
+    benchCaptures();
+    benchSearch();
+    benchTimedSearch();
+    benchSelectiveSearch();
+    return 0;
+}
@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../classes/AttackTables.h"
+
+//
+// searches magic numbers for the slider tables and writes them out as classes/Magics.h
+//
+//   magics [-o path] [--attempts n] [--reduce n] [--threads n]
+//
+// every square first gets a fixed-shift magic (index bits = relevant occupancy bits),
+// then the search keeps trying one bit fewer until it runs out of attempts. each
+// accepted magic is checked against every occupancy before it is written.
+//
+
+struct MagicOptions {
+    std::string output = "Magics.h";
+    uint64_t    attempts = 100000000;      // per square for the fixed-shift search
+    uint64_t    reduceAttempts = 2000000;  // per square and bit for the reduced-shift search
+    int         threads = 0;
+};
+
+struct MagicResult {
+    uint64_t magic = 0;
+    int      bits = 0;
+};
+
+// everything a square's search needs, built once from the ray walkers
+struct SquareData {
+    int                   square;
+    bool                  bishop;
+    uint64_t              mask;
+    int                   maskBits;
+    std::vector<uint64_t> occupancies;
+    std::vector<uint64_t> attacks;
+};
+
+static SquareData squareData(int square, bool bishop)
+{
+    SquareData data;
+    data.square = square;
+    data.bishop = bishop;
+    data.mask = bishop ? AttackTables::generateBishopAttack(square) : AttackTables::generateRookAttack(square);
+    data.maskBits = AttackTables::countBits(data.mask);
+
+    uint64_t occupancy = 0;
+    do {
+        data.occupancies.push_back(occupancy);
+        data.attacks.push_back(bishop ? AttackTables::generateBlockedBishopAttack(square, occupancy)
+                                      : AttackTables::generateBlockedRookAttack(square, occupancy));
+        occupancy = (occupancy - data.mask) & data.mask;
+    } while (occupancy);
+
+    return data;
+}
+
+// xorshift64*, seeded per square so a run gives the same magics whatever the thread count
+struct Random {
+    uint64_t state;
+
+    explicit Random(uint64_t seed) : state(seed ? seed : 0x9e3779b97f4a7c15ULL) {}
+
+    uint64_t next()
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ULL;
+    }
+
+    // few set bits make good magic candidates
+    uint64_t sparse() { return next() & next() & next(); }
+};
+
+//
+// true if every occupancy lands on a slot that is empty or already holds the same attack set
+// used/epoch avoid clearing the whole scratch table between candidates
+//
+static bool tryMagic(const SquareData& data, uint64_t magic, int bits, std::vector<uint64_t>& used, std::vector<uint32_t>& epoch, uint32_t stamp)
+{
+    for (size_t i = 0; i < data.occupancies.size(); i++) {
+        size_t index = (data.occupancies[i] * magic) >> (64 - bits);
+        if (epoch[index] != stamp) {
+            epoch[index] = stamp;
+            used[index] = data.attacks[i];
+        } else if (used[index] != data.attacks[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool findMagic(const SquareData& data, int bits, uint64_t attempts, MagicResult& result)
+{
+    std::vector<uint64_t> used(size_t(1) << bits);
+    std::vector<uint32_t> epoch(size_t(1) << bits, 0);
+    Random random((uint64_t(data.square) << 8) ^ (uint64_t(bits) << 1) ^ (data.bishop ? 1 : 0) ^ 0x5851f42d4c957f2dULL);
+
+    for (uint64_t attempt = 0; attempt < attempts; attempt++) {
+        uint64_t magic = random.sparse();
+        // the top byte of mask * magic has to spread the mask bits around
+        if (AttackTables::countBits((data.mask * magic) & 0xFF00000000000000ULL) < 6)
+            continue;
+        if (tryMagic(data, magic, bits, used, epoch, uint32_t(attempt + 1))) {
+            result.magic = magic;
+            result.bits = bits;
+            return true;
+        }
+    }
+    return false;
+}
+
+// the full check, separate from the search: rebuild the table and compare every entry
+static bool verifyMagic(const SquareData& data, const MagicResult& result)
+{
+    std::vector<uint64_t> table(size_t(1) << result.bits, 0);
+    std::vector<bool> filled(table.size(), false);
+    for (size_t i = 0; i < data.occupancies.size(); i++) {
+        size_t index = (data.occupancies[i] * result.magic) >> (64 - result.bits);
+        if (filled[index] && table[index] != data.attacks[i])
+            return false;
+        table[index] = data.attacks[i];
+        filled[index] = true;
+    }
+    for (size_t i = 0; i < data.occupancies.size(); i++) {
+        size_t index = (data.occupancies[i] * result.magic) >> (64 - result.bits);
+        uint64_t expected = data.bishop ? AttackTables::generateBlockedBishopAttack(data.square, data.occupancies[i])
+                                        : AttackTables::generateBlockedRookAttack(data.square, data.occupancies[i]);
+        if (table[index] != expected)
+            return false;
+    }
+    return true;
+}
+
+static MagicResult searchSquare(int square, bool bishop, const MagicOptions& options)
+{
+    SquareData data = squareData(square, bishop);
+    MagicResult best;
+
+    if (!findMagic(data, data.maskBits, options.attempts, best)) {
+        std::cerr << "no fixed-shift magic for " << (bishop ? "bishop" : "rook") << " square " << square << std::endl;
+        std::exit(1);
+    }
+
+    // keep going a bit at a time while the smaller table still works out
+    MagicResult reduced;
+    while (best.bits > 1 && findMagic(data, best.bits - 1, options.reduceAttempts, reduced)) {
+        best = reduced;
+    }
+
+    if (!verifyMagic(data, best)) {
+        std::cerr << "magic for " << (bishop ? "bishop" : "rook") << " square " << square << " failed verification" << std::endl;
+        std::exit(1);
+    }
+    return best;
+}
+
+static void writeArray(std::ofstream& out, const char* declaration, const MagicResult (&results)[64], bool magics)
+{
+    out << "inline constexpr " << declaration << " = {\n";
+    for (int square = 0; square < 64; square++) {
+        if (magics) {
+            out << "    0x" << std::hex << results[square].magic << std::dec << "ULL";
+        } else {
+            out << (square % 8 ? " " : "    ") << results[square].bits;
+        }
+        if (square < 63)
+            out << ",";
+        if (magics || square % 8 == 7)
+            out << "\n";
+    }
+    out << "};\n\n";
+}
+
+static int slotCount(const MagicResult (&results)[64])
+{
+    int slots = 0;
+    for (const MagicResult& result : results)
+        slots += 1 << result.bits;
+    return slots;
+}
+
+static bool writeHeader(const std::string& path, const MagicResult (&rooks)[64], const MagicResult (&bishops)[64])
+{
+    std::ofstream out(path);
+    if (!out)
+        return false;
+
+    out << "#pragma once\n";
+    out << "#include <cstdint>\n\n";
+    out << "//\n";
+    out << "// Magic numbers for the slider attack tables.\n";
+    out << "// Generated by the magics tool (tools/magics.cpp), run it again instead of editing by hand.\n";
+    out << "// The bits arrays give each square's index width, so squares the search could\n";
+    out << "// shrink below their relevant occupancy bits take a smaller slice of the table.\n";
+    out << "//\n\n";
+    writeArray(out, "int rook_magic_bits[64]", rooks, false);
+    writeArray(out, "uint64_t rook_magic_numbers[64]", rooks, true);
+    writeArray(out, "int bishop_magic_bits[64]", bishops, false);
+    writeArray(out, "uint64_t bishop_magic_numbers[64]", bishops, true);
+    out << "// table entries needed for the bits above\n";
+    out << "inline constexpr int rook_magic_slots = " << slotCount(rooks) << ";\n";
+    out << "inline constexpr int bishop_magic_slots = " << slotCount(bishops) << ";\n";
+    return bool(out);
+}
+
+static bool parseOptions(int argc, char* argv[], MagicOptions& options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-o" && hasValue) {
+            options.output = argv[++i];
+        } else if (arg == "--attempts" && hasValue) {
+            options.attempts = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--reduce" && hasValue) {
+            options.reduceAttempts = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--threads" && hasValue) {
+            options.threads = std::atoi(argv[++i]);
+        } else {
+            std::cerr << "usage: magics [-o path] [--attempts n] [--reduce n] [--threads n]" << std::endl;
+            return false;
+        }
+    }
+    if (options.threads <= 0)
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    MagicOptions options;
+    if (!parseOptions(argc, argv, options))
+        return 2;
+
+    MagicResult rooks[64];
+    MagicResult bishops[64];
+
+    // 128 jobs (64 rook squares, then 64 bishop squares) handed out to the workers
+    std::atomic<int> nextJob{0};
+    auto worker = [&]() {
+        for (int job = nextJob++; job < 128; job = nextJob++) {
+            bool bishop = job >= 64;
+            int square = job & 63;
+            (bishop ? bishops : rooks)[square] = searchSquare(square, bishop, options);
+        }
+    };
+
+    std::cout << "searching magics on " << options.threads << " threads" << std::endl;
+    std::vector<std::thread> workers;
+    for (int i = 0; i < options.threads; i++)
+        workers.emplace_back(worker);
+    for (std::thread& thread : workers)
+        thread.join();
+
+    int reducedRooks = 0;
+    int reducedBishops = 0;
+    for (int square = 0; square < 64; square++) {
+        reducedRooks += rooks[square].bits < AttackTables::rook_relevant_bits[square];
+        reducedBishops += bishops[square].bits < AttackTables::bishop_relevant_bits[square];
+    }
+
+    std::cout << "rook:   " << slotCount(rooks) << " slots, " << reducedRooks << " squares below fixed shift" << std::endl;
+    std::cout << "bishop: " << slotCount(bishops) << " slots, " << reducedBishops << " squares below fixed shift" << std::endl;
+
+    if (!writeHeader(options.output, rooks, bishops)) {
+        std::cerr << "could not write " << options.output << std::endl;
+        return 1;
+    }
+    std::cout << "wrote " << options.output << std::endl;
+    return 0;
+}
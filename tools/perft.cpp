@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../classes/MoveGenerator.h"
+#include "../classes/Perft.h"
+#include "Timing.h"
+
+//
+// counts move-tree leaves to check the move generator and time it, no ImGui needed
+//
+//   perft [--fen FEN] [--depth n] [--divide] [--expect nodes] [--threads n] [--hash MB]
+//   perft --suite [--depth n] [--threads n] [--hash MB]
+//
+// the tree is split over --threads workers, all cores by default, and the leaves
+// each one counted are printed after the total.
+// --divide prints the count under each root move, for comparing against another engine.
+// --suite runs the standard positions against their published counts, --depth caps
+// how deep it goes. It also checks that MoveGenerator::isLegal accepts exactly the
+// generated moves in each position and the ones a move away. Exits 1 when a count or
+// that check doesn't match.
+// --hash caches subtree counts in a table of that many MB shared by the threads,
+// which makes depth 7-8 runs practical.
+//
+
+static const char* initialFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+struct PerftOptions {
+    std::string fen = initialFen;
+    int         depth = 0;
+    bool        divide = false;
+    bool        suite = false;
+    uint64_t    expect = 0;
+    int         threads = 0;
+    size_t      hashMegabytes = 0;
+};
+
+// published counts from the chessprogramming wiki, nodes[d - 1] for depth d
+struct SuitePosition {
+    const char* name;
+    const char* fen;
+    int         depth;          // depth run by default
+    uint64_t    nodes[7];
+};
+
+static const SuitePosition suitePositions[] = {
+    { "initial", initialFen, 5,
+      { 20, 400, 8902, 197281, 4865609, 119060324 } },
+    { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4,
+      { 48, 2039, 97862, 4085603, 193690690 } },
+    { "position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 6,
+      { 14, 191, 2812, 43238, 674624, 11030083, 178633661 } },
+    { "position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5,
+      { 6, 264, 9467, 422333, 15833292, 706045033 } },
+    { "position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4,
+      { 44, 1486, 62379, 2103487, 89941194 } },
+    { "position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4,
+      { 46, 2079, 89890, 3894594, 164075551 } },
+};
+
+// the count under each root move, summed from the jobs that start with it
+static void printDivide(MoveGenerator& mg, const PerftResult& result)
+{
+    MoveList moves;
+    mg.generateMoves(moves);
+    for (uint16_t move : moves) {
+        uint64_t count = 0;
+        for (const PerftJob& job : result.jobs) {
+            if (job.moves[0] == move)
+                count += job.nodes;
+        }
+        std::cout << mg.moveToString(move) << ": " << count << std::endl;
+    }
+    std::cout << std::endl << "moves: " << moves.count << std::endl;
+}
+
+static void printThreads(const PerftResult& result)
+{
+    std::cout << "  threads:";
+    for (uint64_t nodes : result.threadNodes)
+        std::cout << " " << nodes;
+    std::cout << std::endl;
+}
+
+static void printHash(const PerftTable* table, const PerftResult& result)
+{
+    if (!table)
+        return;
+    const PerftStats& stats = result.hashStats;
+    double hitRate = stats.probes ? 100.0 * stats.hits / stats.probes : 0;
+    std::cout << "  hash: " << table->bytes() / (1024 * 1024) << " MB  " << stats.probes << " probes  "
+              << hitRate << "% hits" << std::endl;
+}
+
+static void report(const char* name, int depth, uint64_t nodes, double ms)
+{
+    std::cout << name << "  depth " << depth << "  " << nodes << " nodes  " << ms << " ms  "
+              << nodesPerSecond(nodes, ms) << " nps";
+}
+
+// isLegal, which vets hash and killer moves, against the generator for every 16-bit
+// value: it must accept exactly the generated moves, apart from castling and en passant,
+// which it always leaves to the generator
+static int isLegalMismatches(MoveGenerator& mg)
+{
+    MoveList moves;
+    mg.generateMoves(moves);
+    std::vector<bool> generated(1 << 16);
+    for (uint16_t move : moves)
+        generated[move] = !mg.getCastle(move) && !mg.getEnpassant(move);
+
+    int mismatches = 0;
+    for (uint32_t move = 0; move <= 0xffff; move++)
+        mismatches += mg.isLegal(uint16_t(move)) != generated[move];
+    return mismatches;
+}
+
+// the position and every one a move away
+static int isLegalMismatchesAround(MoveGenerator& mg)
+{
+    int mismatches = isLegalMismatches(mg);
+    MoveList moves;
+    mg.generateMoves(moves);
+    MoveGenerator::UndoRecord undo;
+    for (uint16_t move : moves) {
+        mg.makeMove(move, undo);
+        mismatches += isLegalMismatches(mg);
+        mg.unmakeMove(move, undo);
+    }
+    return mismatches;
+}
+
+static int runSuite(const PerftOptions& options, PerftTable* table)
+{
+    MoveGenerator mg;
+    uint64_t totalNodes = 0;
+    double totalMs = 0;
+    int failures = 0;
+
+    for (const SuitePosition& position : suitePositions) {
+        int depth = position.depth;
+        if (options.depth > 0) {
+            // don't go past the deepest published count
+            depth = options.depth;
+            while (depth > 1 && !position.nodes[depth - 1])
+                depth--;
+        }
+        mg.parseFen(position.fen);
+        auto start = Clock::now();
+        PerftResult result = perftParallel(mg, depth, options.threads, table);
+        double ms = elapsedMs(start);
+        uint64_t nodes = result.nodes;
+
+        bool match = nodes == position.nodes[depth - 1];
+        failures += !match;
+        totalNodes += nodes;
+        totalMs += ms;
+
+        report(position.name, depth, nodes, ms);
+        if (match)
+            std::cout << "  ok" << std::endl;
+        else
+            std::cout << "  MISMATCH, expected " << position.nodes[depth - 1] << std::endl;
+        printThreads(result);
+        printHash(table, result);
+
+        int mismatches = isLegalMismatchesAround(mg);
+        failures += mismatches != 0;
+        if (mismatches)
+            std::cout << "  isLegal: " << mismatches << " moves disagree with the generator" << std::endl;
+        else
+            std::cout << "  isLegal: ok" << std::endl;
+    }
+
+    std::cout << "total  " << totalNodes << " nodes  " << totalMs << " ms  " << nodesPerSecond(totalNodes, totalMs) << " nps" << std::endl;
+    if (failures)
+        std::cout << failures << " position(s) did not match" << std::endl;
+    return failures ? 1 : 0;
+}
+
+static bool parseOptions(int argc, char* argv[], PerftOptions& options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--fen" && hasValue) {
+            options.fen = argv[++i];
+        } else if (arg == "--depth" && hasValue) {
+            options.depth = std::atoi(argv[++i]);
+        } else if (arg == "--expect" && hasValue) {
+            options.expect = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--hash" && hasValue) {
+            options.hashMegabytes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--threads" && hasValue) {
+            options.threads = std::atoi(argv[++i]);
+        } else if (arg == "--divide" || arg == "divide") {
+            options.divide = true;
+        } else if (arg == "--suite") {
+            options.suite = true;
+        } else {
+            std::cerr << "usage: perft [--fen FEN] [--depth n] [--divide] [--expect nodes] [--threads n] [--hash MB]" << std::endl;
+            std::cerr << "       perft --suite [--depth n] [--threads n] [--hash MB]" << std::endl;
+            return false;
+        }
+    }
+    if (options.depth < 0 || (!options.suite && options.depth == 0)) {
+        std::cerr << "perft needs --depth of 1 or more" << std::endl;
+        return false;
+    }
+    if (options.threads <= 0)
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    PerftOptions options;
+    if (!parseOptions(argc, argv, options))
+        return 2;
+
+    // one table for the whole run, the keys tell positions apart
+    std::unique_ptr<PerftTable> table;
+    if (options.hashMegabytes)
+        table = std::make_unique<PerftTable>(options.hashMegabytes);
+
+    if (options.suite)
+        return runSuite(options, table.get());
+
+    MoveGenerator mg;
+    mg.parseFen(options.fen.c_str());
+
+    auto start = Clock::now();
+    PerftResult result = perftParallel(mg, options.depth, options.threads, table.get());
+    double ms = elapsedMs(start);
+    uint64_t nodes = result.nodes;
+
+    if (options.divide)
+        printDivide(mg, result);
+    report("perft", options.depth, nodes, ms);
+    std::cout << std::endl;
+    printThreads(result);
+    printHash(table.get(), result);
+
+    if (options.expect && nodes != options.expect) {
+        std::cout << "MISMATCH, expected " << options.expect << std::endl;
+        return 1;
+    }
+    return 0;
+}